@@ -10,12 +10,29 @@ namespace siren::client
         std::string sampling_rate = getenv("SAMPLING_RATE");
         std::string channel_count = getenv("CHANNEL_COUNT");
         std::string window_size = getenv("WINDOW_SIZE");
+        std::string hop_size = getenv("HOP_SIZE");
+        std::string silence_threshold = getenv("SILENCE_THRESHOLD");
+        std::string frequency_scale = getenv("FREQUENCY_SCALE");
+        std::string filter_count = getenv("FILTER_COUNT");
         std::string zscore = getenv("CORE_PEAK_ZSCORE");
         std::string band_count = getenv("CORE_FREQ_BAND_COUNT");
         std::string min_peak_count = getenv("MIN_PEAK_COUNT");
         std::string block_size = getenv("CORE_BLOCK_SIZE");
         std::string window_function = getenv("WINDOW_FUNCTION");
         std::string stride_coeff = getenv("CORE_BLOCK_STRIDE_COEFF");
+        std::string stream_decode = getenv("STREAM_DECODE");
+        std::string stream_chunk_size = getenv("STREAM_CHUNK_SIZE");
+        std::string mmap_input = getenv("MMAP_INPUT");
+        std::string low_memory = getenv("LOW_MEMORY");
+        std::string resampler_quality = getenv("RESAMPLER_QUALITY");
+        std::string pcm_cache_budget = getenv("PCM_CACHE_BUDGET");
+        std::string spectrogram_cache_dir = getenv("SPECTROGRAM_CACHE_DIR");
+        std::string fft_backend = getenv("FFT_BACKEND");
+        std::string stft_threads = getenv("STFT_THREADS");
+        std::string stats_engine = getenv("STATS_ENGINE");
+        std::string peak_detector = getenv("PEAK_DETECTOR");
+        std::string neighborhood_frames = getenv("PEAK_NEIGHBORHOOD_FRAMES");
+        std::string neighborhood_bins = getenv("PEAK_NEIGHBORHOOD_BINS");
 
         if (!sampling_rate.empty())
         {
@@ -29,6 +46,32 @@ namespace siren::client
         {
             convert_to_type(window_size, spec.core_params.target_window_size);
         }
+        if (!hop_size.empty())
+        {
+            convert_to_type(hop_size, spec.core_params.target_hop_size);
+        }
+        if (!silence_threshold.empty())
+        {
+        #ifndef __clang__
+            convert_to_type(silence_threshold, spec.core_params.silence_threshold);
+        #else
+            float silence_threshold_f = std::stof(silence_threshold);
+            release_assert(!isnan(silence_threshold_f), "silence_threshold_f is nan");
+            spec.core_params.silence_threshold = silence_threshold_f;
+        #endif
+        }
+        if (frequency_scale == "Log")
+        {
+            spec.core_params.frequency_scale = FrequencyScale::Log;
+        }
+        else if (frequency_scale == "Mel")
+        {
+            spec.core_params.frequency_scale = FrequencyScale::Mel;
+        }
+        if (!filter_count.empty())
+        {
+            convert_to_type(filter_count, spec.core_params.filter_count);
+        }
         if (!band_count.empty())
         {
             convert_to_type(band_count, spec.core_params.target_band_count);
@@ -61,6 +104,74 @@ namespace siren::client
             spec.core_params.stride_coeff = stride_coeff_f;
         #endif
         }
+        if (!stream_decode.empty())
+        {
+            spec.core_params.stream_decode = stream_decode == "1" || stream_decode == "true";
+        }
+        if (!stream_chunk_size.empty())
+        {
+            convert_to_type(stream_chunk_size, spec.core_params.stream_chunk_size);
+        }
+        if (!mmap_input.empty())
+        {
+            spec.core_params.mmap_input = mmap_input == "1" || mmap_input == "true";
+        }
+        if (!low_memory.empty())
+        {
+            spec.core_params.low_memory = low_memory == "1" || low_memory == "true";
+        }
+        if (!resampler_quality.empty())
+        {
+            spec.core_params.builtin_resampler = true;
+            if (resampler_quality == "Fast")
+            {
+                spec.core_params.resampler_quality = audio::ResamplerQuality::Fast;
+            }
+            else if (resampler_quality == "Best")
+            {
+                spec.core_params.resampler_quality = audio::ResamplerQuality::Best;
+            }
+        }
+        if (!pcm_cache_budget.empty())
+        {
+            convert_to_type(pcm_cache_budget, spec.core_params.pcm_cache_budget);
+        }
+        if (!spectrogram_cache_dir.empty())
+        {
+            spec.core_params.spectrogram_cache_dir = spectrogram_cache_dir;
+        }
+        if (!stft_threads.empty())
+        {
+            convert_to_type(stft_threads, spec.core_params.stft_threads);
+        }
+        if (stats_engine == "Sort")
+        {
+            spec.core_params.stats_engine = StatsEngine::Sort;
+        }
+        if (peak_detector == "LocalMaximum")
+        {
+            spec.core_params.peak_detector = PeakDetector::LocalMaximum;
+        }
+        if (!neighborhood_frames.empty())
+        {
+            convert_to_type(neighborhood_frames, spec.core_params.peak_neighborhood.frames);
+        }
+        if (!neighborhood_bins.empty())
+        {
+            convert_to_type(neighborhood_bins, spec.core_params.peak_neighborhood.bins);
+        }
+        if (fft_backend == "KissReal")
+        {
+            spec.core_params.target_fft_backend = FFTBackend::KissReal;
+        }
+        else if (fft_backend == "Batched")
+        {
+            spec.core_params.target_fft_backend = FFTBackend::Batched;
+        }
+        else if (fft_backend == "FixedPoint")
+        {
+            spec.core_params.target_fft_backend = FFTBackend::FixedPoint;
+        }
         if (!window_function.empty())
         {
             if (window_function == "Hamming")
@@ -86,6 +197,16 @@ namespace siren::client
     }
 
     std::string ClientWrapper::process_track(const std::string& track_path)
+    {
+        return make_response(m_core->make_fingerprint(track_path));
+    }
+
+    std::string ClientWrapper::process_track(const void* data, size_t size)
+    {
+        return make_response(m_core->make_fingerprint(data, size));
+    }
+
+    std::string ClientWrapper::make_response(const siren::CoreReturnType& core_response) const
     {
         auto generate_response = [](const std::string& core_code, const std::string& body)
         {
@@ -94,7 +215,6 @@ namespace siren::client
                    "\"core_code\": " + core_code +
                    "}";
         };
-        siren::CoreReturnType core_response = m_core->make_fingerprint(track_path);
         if (!core_response)
         {
             return generate_response(std::to_string((int)core_response.code), "core failed to fingerprint the track");
@@ -9,6 +9,10 @@ namespace siren::client
         ClientWrapper();
         ~ClientWrapper();
         std::string process_track(const std::string& track_path);
+        std::string process_track(const void* data, size_t size);
+
+    private:
+        std::string make_response(const siren::CoreReturnType& core_response) const;
 
     private:
         SirenCore* m_core;
@@ -14,7 +14,8 @@ namespace siren
         PeaksTooSparse = -1,
         TargetFileDoesNotExist = -2,
         CoreParamsFatalError = -3,
-        CoreParamsLogicError = -4
+        CoreParamsLogicError = -4,
+        TargetBufferIsInvalid = -5
     };
 
     std::string getenv(const std::string& name);
@@ -0,0 +1,651 @@
+#include <algorithm>
+#include <cmath>
+#include "simd.h"
+
+#ifdef SIREN_SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace siren::simd
+{
+    namespace
+    {
+        constexpr size_t s_lanes = 8;
+        constexpr float s_int16_scale = 1.0f / 32768.0f;
+
+        float reduce_lanes(const float* lanes)
+        {
+            return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+        }
+
+        float dot_product_scalar(const float* lhs, const float* rhs, size_t size)
+        {
+            float lanes[s_lanes] = {};
+            size_t i = 0;
+            for (; i + s_lanes <= size; i += s_lanes)
+            {
+                for (size_t j = 0; j < s_lanes; j++)
+                {
+                    lanes[j] += lhs[i + j] * rhs[i + j];
+                }
+            }
+            for (size_t j = 0; i < size; i++, j++)
+            {
+                lanes[j] += lhs[i] * rhs[i];
+            }
+            return reduce_lanes(lanes);
+        }
+
+        void int16_to_float_scalar(const int16_t* input, float* output, size_t size)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                output[i] = static_cast<float>(input[i]) * s_int16_scale;
+            }
+        }
+
+        void downmix_scalar(const float* input, size_t frame_count, unsigned int channels, float* output)
+        {
+            const float scale = 1.0f / channels;
+            for (size_t i = 0; i < frame_count; i++)
+            {
+                float sum = input[i * channels];
+                for (unsigned int c = 1; c < channels; c++)
+                {
+                    sum += input[i * channels + c];
+                }
+                output[i] = sum * scale;
+            }
+        }
+
+        void apply_window_scalar(const float* input, const float* window, float* output, size_t size)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                output[i] = input[i] * window[i];
+            }
+        }
+
+        template<typename T>
+        void maximum_scalar(const T* lhs, const T* rhs, T* output, size_t size)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                output[i] = std::max(lhs[i], rhs[i]);
+            }
+        }
+
+        void apply_window_complex_scalar(const float* input, const float* window, float* output, size_t size)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                output[i * 2] = input[i] * window[i];
+                output[i * 2 + 1] = 0.0f;
+            }
+        }
+
+        void power_scalar(const float* re, const float* im, float* output, size_t size)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                double r = re[i];
+                double j = im[i];
+                output[i] = static_cast<float>(r * r + j * j);
+            }
+        }
+
+        void magnitude_scalar(const float* re, const float* im, float* output, size_t size)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                double r = re[i];
+                double j = im[i];
+                output[i] = static_cast<float>(std::sqrt(r * r + j * j));
+            }
+        }
+
+#ifdef SIREN_SIMD_X86
+        __attribute__((target("sse2"))) float dot_product_sse2(const float* lhs, const float* rhs, size_t size)
+        {
+            __m128 lo = _mm_setzero_ps();
+            __m128 hi = _mm_setzero_ps();
+            size_t i = 0;
+            for (; i + s_lanes <= size; i += s_lanes)
+            {
+                lo = _mm_add_ps(lo, _mm_mul_ps(_mm_loadu_ps(lhs + i), _mm_loadu_ps(rhs + i)));
+                hi = _mm_add_ps(hi, _mm_mul_ps(_mm_loadu_ps(lhs + i + 4), _mm_loadu_ps(rhs + i + 4)));
+            }
+            float lanes[s_lanes];
+            _mm_storeu_ps(lanes, lo);
+            _mm_storeu_ps(lanes + 4, hi);
+            for (size_t j = 0; i < size; i++, j++)
+            {
+                lanes[j] += lhs[i] * rhs[i];
+            }
+            return reduce_lanes(lanes);
+        }
+
+        __attribute__((target("avx2"))) float dot_product_avx2(const float* lhs, const float* rhs, size_t size)
+        {
+            __m256 acc = _mm256_setzero_ps();
+            size_t i = 0;
+            for (; i + s_lanes <= size; i += s_lanes)
+            {
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(lhs + i), _mm256_loadu_ps(rhs + i)));
+            }
+            float lanes[s_lanes];
+            _mm256_storeu_ps(lanes, acc);
+            for (size_t j = 0; i < size; i++, j++)
+            {
+                lanes[j] += lhs[i] * rhs[i];
+            }
+            return reduce_lanes(lanes);
+        }
+
+        __attribute__((target("sse2"))) void int16_to_float_sse2(const int16_t* input, float* output, size_t size)
+        {
+            const __m128 scale = _mm_set1_ps(s_int16_scale);
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+                __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+                __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+                _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+                _mm_storeu_ps(output + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+            }
+            int16_to_float_scalar(input + i, output + i, size - i);
+        }
+
+        __attribute__((target("avx2"))) void int16_to_float_avx2(const int16_t* input, float* output, size_t size)
+        {
+            const __m256 scale = _mm256_set1_ps(s_int16_scale);
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                __m256i samples = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i)));
+                _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(samples), scale));
+            }
+            int16_to_float_scalar(input + i, output + i, size - i);
+        }
+
+        __attribute__((target("sse2"))) void downmix_sse2(const float* input, size_t frame_count, unsigned int channels, float* output)
+        {
+            if (channels != 2)
+            {
+                downmix_scalar(input, frame_count, channels, output);
+                return;
+            }
+            const __m128 half = _mm_set1_ps(0.5f);
+            size_t i = 0;
+            for (; i + 4 <= frame_count; i += 4)
+            {
+                __m128 a = _mm_loadu_ps(input + i * 2);
+                __m128 b = _mm_loadu_ps(input + i * 2 + 4);
+                __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+                __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+                _mm_storeu_ps(output + i, _mm_mul_ps(_mm_add_ps(left, right), half));
+            }
+            downmix_scalar(input + i * 2, frame_count - i, channels, output + i);
+        }
+
+        __attribute__((target("avx2"))) void downmix_avx2(const float* input, size_t frame_count, unsigned int channels, float* output)
+        {
+            if (channels != 2)
+            {
+                downmix_scalar(input, frame_count, channels, output);
+                return;
+            }
+            const __m256 half = _mm256_set1_ps(0.5f);
+            size_t i = 0;
+            for (; i + 8 <= frame_count; i += 8)
+            {
+                __m256 a = _mm256_loadu_ps(input + i * 2);
+                __m256 b = _mm256_loadu_ps(input + i * 2 + 8);
+                // hadd pairs frames as [0 1 4 5 | 2 3 6 7], the permute restores their order
+                __m256 sum = _mm256_hadd_ps(a, b);
+                sum = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sum), _MM_SHUFFLE(3, 1, 2, 0)));
+                _mm256_storeu_ps(output + i, _mm256_mul_ps(sum, half));
+            }
+            downmix_scalar(input + i * 2, frame_count - i, channels, output + i);
+        }
+
+        __attribute__((target("sse2"))) void apply_window_sse2(const float* input, const float* window, float* output, size_t size)
+        {
+            size_t i = 0;
+            for (; i + 4 <= size; i += 4)
+            {
+                _mm_storeu_ps(output + i, _mm_mul_ps(_mm_loadu_ps(input + i), _mm_loadu_ps(window + i)));
+            }
+            apply_window_scalar(input + i, window + i, output + i, size - i);
+        }
+
+        __attribute__((target("avx2"))) void apply_window_avx2(const float* input, const float* window, float* output, size_t size)
+        {
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_loadu_ps(input + i), _mm256_loadu_ps(window + i)));
+            }
+            apply_window_scalar(input + i, window + i, output + i, size - i);
+        }
+
+        __attribute__((target("avx512f"))) void apply_window_avx512(const float* input, const float* window, float* output, size_t size)
+        {
+            size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                _mm512_storeu_ps(output + i, _mm512_mul_ps(_mm512_loadu_ps(input + i), _mm512_loadu_ps(window + i)));
+            }
+            apply_window_scalar(input + i, window + i, output + i, size - i);
+        }
+
+        __attribute__((target("sse2"))) void maximum_sse2(const float* lhs, const float* rhs, float* output, size_t size)
+        {
+            size_t i = 0;
+            for (; i + 4 <= size; i += 4)
+            {
+                _mm_storeu_ps(output + i, _mm_max_ps(_mm_loadu_ps(lhs + i), _mm_loadu_ps(rhs + i)));
+            }
+            maximum_scalar(lhs + i, rhs + i, output + i, size - i);
+        }
+
+        __attribute__((target("avx2"))) void maximum_avx2(const float* lhs, const float* rhs, float* output, size_t size)
+        {
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                _mm256_storeu_ps(output + i, _mm256_max_ps(_mm256_loadu_ps(lhs + i), _mm256_loadu_ps(rhs + i)));
+            }
+            maximum_scalar(lhs + i, rhs + i, output + i, size - i);
+        }
+
+        __attribute__((target("avx512f"))) void maximum_avx512(const float* lhs, const float* rhs, float* output, size_t size)
+        {
+            size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                _mm512_storeu_ps(output + i, _mm512_max_ps(_mm512_loadu_ps(lhs + i), _mm512_loadu_ps(rhs + i)));
+            }
+            maximum_scalar(lhs + i, rhs + i, output + i, size - i);
+        }
+
+        __attribute__((target("sse2"))) void maximum_int32_sse2(const int32_t* lhs, const int32_t* rhs, int32_t* output, size_t size)
+        {
+            // sse2 has no signed 32-bit max, the comparison mask selects between the inputs
+            size_t i = 0;
+            for (; i + 4 <= size; i += 4)
+            {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs + i));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs + i));
+                __m128i greater = _mm_cmpgt_epi32(a, b);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b)));
+            }
+            maximum_scalar(lhs + i, rhs + i, output + i, size - i);
+        }
+
+        __attribute__((target("avx2"))) void maximum_int32_avx2(const int32_t* lhs, const int32_t* rhs, int32_t* output, size_t size)
+        {
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i));
+                __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), _mm256_max_epi32(a, b));
+            }
+            maximum_scalar(lhs + i, rhs + i, output + i, size - i);
+        }
+
+        __attribute__((target("avx512f"))) void maximum_int32_avx512(const int32_t* lhs, const int32_t* rhs, int32_t* output, size_t size)
+        {
+            size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                _mm512_storeu_si512(output + i, _mm512_max_epi32(_mm512_loadu_si512(lhs + i), _mm512_loadu_si512(rhs + i)));
+            }
+            maximum_scalar(lhs + i, rhs + i, output + i, size - i);
+        }
+
+        __attribute__((target("sse2"))) void apply_window_complex_sse2(const float* input, const float* window, float* output, size_t size)
+        {
+            const __m128 zero = _mm_setzero_ps();
+            size_t i = 0;
+            for (; i + 4 <= size; i += 4)
+            {
+                __m128 windowed = _mm_mul_ps(_mm_loadu_ps(input + i), _mm_loadu_ps(window + i));
+                _mm_storeu_ps(output + i * 2, _mm_unpacklo_ps(windowed, zero));
+                _mm_storeu_ps(output + i * 2 + 4, _mm_unpackhi_ps(windowed, zero));
+            }
+            apply_window_complex_scalar(input + i, window + i, output + i * 2, size - i);
+        }
+
+        __attribute__((target("avx2"))) void apply_window_complex_avx2(const float* input, const float* window, float* output, size_t size)
+        {
+            const __m256 zero = _mm256_setzero_ps();
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                __m256 windowed = _mm256_mul_ps(_mm256_loadu_ps(input + i), _mm256_loadu_ps(window + i));
+                // unpack works per 128-bit half, giving [0 1 | 4 5] and [2 3 | 6 7]
+                __m256 lo = _mm256_unpacklo_ps(windowed, zero);
+                __m256 hi = _mm256_unpackhi_ps(windowed, zero);
+                _mm256_storeu_ps(output + i * 2, _mm256_permute2f128_ps(lo, hi, 0x20));
+                _mm256_storeu_ps(output + i * 2 + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+            }
+            apply_window_complex_scalar(input + i, window + i, output + i * 2, size - i);
+        }
+
+        template<bool Sqrt>
+        __attribute__((target("sse2"))) void power_sse2(const float* re, const float* im, float* output, size_t size)
+        {
+            size_t i = 0;
+            for (; i + 4 <= size; i += 4)
+            {
+                __m128 r = _mm_loadu_ps(re + i);
+                __m128 j = _mm_loadu_ps(im + i);
+                __m128d r_lo = _mm_cvtps_pd(r);
+                __m128d r_hi = _mm_cvtps_pd(_mm_movehl_ps(r, r));
+                __m128d j_lo = _mm_cvtps_pd(j);
+                __m128d j_hi = _mm_cvtps_pd(_mm_movehl_ps(j, j));
+                __m128d lo = _mm_add_pd(_mm_mul_pd(r_lo, r_lo), _mm_mul_pd(j_lo, j_lo));
+                __m128d hi = _mm_add_pd(_mm_mul_pd(r_hi, r_hi), _mm_mul_pd(j_hi, j_hi));
+                if constexpr (Sqrt)
+                {
+                    lo = _mm_sqrt_pd(lo);
+                    hi = _mm_sqrt_pd(hi);
+                }
+                _mm_storeu_ps(output + i, _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi)));
+            }
+            if constexpr (Sqrt)
+            {
+                magnitude_scalar(re + i, im + i, output + i, size - i);
+            }
+            else
+            {
+                power_scalar(re + i, im + i, output + i, size - i);
+            }
+        }
+
+        template<bool Sqrt>
+        __attribute__((target("avx2"))) void power_avx2(const float* re, const float* im, float* output, size_t size)
+        {
+            size_t i = 0;
+            for (; i + 4 <= size; i += 4)
+            {
+                __m256d r = _mm256_cvtps_pd(_mm_loadu_ps(re + i));
+                __m256d j = _mm256_cvtps_pd(_mm_loadu_ps(im + i));
+                __m256d sum = _mm256_add_pd(_mm256_mul_pd(r, r), _mm256_mul_pd(j, j));
+                if constexpr (Sqrt)
+                {
+                    sum = _mm256_sqrt_pd(sum);
+                }
+                _mm_storeu_ps(output + i, _mm256_cvtpd_ps(sum));
+            }
+            if constexpr (Sqrt)
+            {
+                magnitude_scalar(re + i, im + i, output + i, size - i);
+            }
+            else
+            {
+                power_scalar(re + i, im + i, output + i, size - i);
+            }
+        }
+
+        template<bool Sqrt>
+        __attribute__((target("avx512f"))) void power_avx512(const float* re, const float* im, float* output, size_t size)
+        {
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                __m512d r = _mm512_cvtps_pd(_mm256_loadu_ps(re + i));
+                __m512d j = _mm512_cvtps_pd(_mm256_loadu_ps(im + i));
+                __m512d sum = _mm512_add_pd(_mm512_mul_pd(r, r), _mm512_mul_pd(j, j));
+                if constexpr (Sqrt)
+                {
+                    sum = _mm512_sqrt_pd(sum);
+                }
+                _mm256_storeu_ps(output + i, _mm512_cvtpd_ps(sum));
+            }
+            if constexpr (Sqrt)
+            {
+                magnitude_scalar(re + i, im + i, output + i, size - i);
+            }
+            else
+            {
+                power_scalar(re + i, im + i, output + i, size - i);
+            }
+        }
+#endif
+
+        InstructionSet detect_instruction_set()
+        {
+#ifdef SIREN_SIMD_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f"))
+            {
+                return InstructionSet::AVX512;
+            }
+            if (__builtin_cpu_supports("avx2"))
+            {
+                return InstructionSet::AVX2;
+            }
+            if (__builtin_cpu_supports("sse2"))
+            {
+                return InstructionSet::SSE2;
+            }
+#endif
+            return InstructionSet::Scalar;
+        }
+    }// namespace
+
+    InstructionSet get_instruction_set()
+    {
+        static const InstructionSet s_instruction_set = detect_instruction_set();
+        return s_instruction_set;
+    }
+
+    float dot_product(const float* lhs, const float* rhs, size_t size)
+    {
+        using Kernel = float (*)(const float*, const float*, size_t);
+        static const Kernel s_kernel = []() -> Kernel
+        {
+            switch (get_instruction_set())
+            {
+#ifdef SIREN_SIMD_X86
+            case InstructionSet::AVX512:
+            case InstructionSet::AVX2:
+                return dot_product_avx2;
+            case InstructionSet::SSE2:
+                return dot_product_sse2;
+#endif
+            default:
+                return dot_product_scalar;
+            }
+        }();
+        return s_kernel(lhs, rhs, size);
+    }
+
+    void int16_to_float(const int16_t* input, float* output, size_t size)
+    {
+        using Kernel = void (*)(const int16_t*, float*, size_t);
+        static const Kernel s_kernel = []() -> Kernel
+        {
+            switch (get_instruction_set())
+            {
+#ifdef SIREN_SIMD_X86
+            case InstructionSet::AVX512:
+            case InstructionSet::AVX2:
+                return int16_to_float_avx2;
+            case InstructionSet::SSE2:
+                return int16_to_float_sse2;
+#endif
+            default:
+                return int16_to_float_scalar;
+            }
+        }();
+        s_kernel(input, output, size);
+    }
+
+    void downmix(const float* input, size_t frame_count, unsigned int channels, float* output)
+    {
+        using Kernel = void (*)(const float*, size_t, unsigned int, float*);
+        static const Kernel s_kernel = []() -> Kernel
+        {
+            switch (get_instruction_set())
+            {
+#ifdef SIREN_SIMD_X86
+            case InstructionSet::AVX512:
+            case InstructionSet::AVX2:
+                return downmix_avx2;
+            case InstructionSet::SSE2:
+                return downmix_sse2;
+#endif
+            default:
+                return downmix_scalar;
+            }
+        }();
+        s_kernel(input, frame_count, channels, output);
+    }
+
+    void apply_window(const float* input, const float* window, float* output, size_t size)
+    {
+        using Kernel = void (*)(const float*, const float*, float*, size_t);
+        static const Kernel s_kernel = []() -> Kernel
+        {
+            switch (get_instruction_set())
+            {
+#ifdef SIREN_SIMD_X86
+            case InstructionSet::AVX512:
+                return apply_window_avx512;
+            case InstructionSet::AVX2:
+                return apply_window_avx2;
+            case InstructionSet::SSE2:
+                return apply_window_sse2;
+#endif
+            default:
+                return apply_window_scalar;
+            }
+        }();
+        s_kernel(input, window, output, size);
+    }
+
+    void maximum(const float* lhs, const float* rhs, float* output, size_t size)
+    {
+        using Kernel = void (*)(const float*, const float*, float*, size_t);
+        static const Kernel s_kernel = []() -> Kernel
+        {
+            switch (get_instruction_set())
+            {
+#ifdef SIREN_SIMD_X86
+            case InstructionSet::AVX512:
+                return maximum_avx512;
+            case InstructionSet::AVX2:
+                return maximum_avx2;
+            case InstructionSet::SSE2:
+                return maximum_sse2;
+#endif
+            default:
+                return maximum_scalar<float>;
+            }
+        }();
+        s_kernel(lhs, rhs, output, size);
+    }
+
+    void maximum(const int32_t* lhs, const int32_t* rhs, int32_t* output, size_t size)
+    {
+        using Kernel = void (*)(const int32_t*, const int32_t*, int32_t*, size_t);
+        static const Kernel s_kernel = []() -> Kernel
+        {
+            switch (get_instruction_set())
+            {
+#ifdef SIREN_SIMD_X86
+            case InstructionSet::AVX512:
+                return maximum_int32_avx512;
+            case InstructionSet::AVX2:
+                return maximum_int32_avx2;
+            case InstructionSet::SSE2:
+                return maximum_int32_sse2;
+#endif
+            default:
+                return maximum_scalar<int32_t>;
+            }
+        }();
+        s_kernel(lhs, rhs, output, size);
+    }
+
+    void apply_window_complex(const float* input, const float* window, float* output, size_t size)
+    {
+        using Kernel = void (*)(const float*, const float*, float*, size_t);
+        static const Kernel s_kernel = []() -> Kernel
+        {
+            switch (get_instruction_set())
+            {
+#ifdef SIREN_SIMD_X86
+            case InstructionSet::AVX512:
+            case InstructionSet::AVX2:
+                return apply_window_complex_avx2;
+            case InstructionSet::SSE2:
+                return apply_window_complex_sse2;
+#endif
+            default:
+                return apply_window_complex_scalar;
+            }
+        }();
+        s_kernel(input, window, output, size);
+    }
+
+    void power(const float* re, const float* im, float* output, size_t size)
+    {
+        using Kernel = void (*)(const float*, const float*, float*, size_t);
+        static const Kernel s_kernel = []() -> Kernel
+        {
+            switch (get_instruction_set())
+            {
+#ifdef SIREN_SIMD_X86
+            case InstructionSet::AVX512:
+                return power_avx512<false>;
+            case InstructionSet::AVX2:
+                return power_avx2<false>;
+            case InstructionSet::SSE2:
+                return power_sse2<false>;
+#endif
+            default:
+                return power_scalar;
+            }
+        }();
+        s_kernel(re, im, output, size);
+    }
+
+    void magnitude(const float* re, const float* im, float* output, size_t size)
+    {
+        using Kernel = void (*)(const float*, const float*, float*, size_t);
+        static const Kernel s_kernel = []() -> Kernel
+        {
+            switch (get_instruction_set())
+            {
+#ifdef SIREN_SIMD_X86
+            case InstructionSet::AVX512:
+                return power_avx512<true>;
+            case InstructionSet::AVX2:
+                return power_avx2<true>;
+            case InstructionSet::SSE2:
+                return power_sse2<true>;
+#endif
+            default:
+                return magnitude_scalar;
+            }
+        }();
+        s_kernel(re, im, output, size);
+    }
+
+    void magnitude_db(const float* re, const float* im, float* output, size_t size, float floor_db)
+    {
+        // the vectorized part is the power, log10 stays scalar so results do not depend on the cpu
+        power(re, im, output, size);
+        for (size_t i = 0; i < size; i++)
+        {
+            output[i] = std::max(10.0f * std::log10(output[i]), floor_db);
+        }
+    }
+
+}// namespace siren::simd
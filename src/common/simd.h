@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SIREN_SIMD_X86
+#endif
+
+namespace siren::simd
+{
+    enum class InstructionSet
+    {
+        Scalar,
+        SSE2,
+        AVX2,
+        AVX512
+    };
+
+    /**
+    * widest instruction set supported by the running cpu, detected once per process,
+    * kernels below dispatch on it at runtime
+    */
+    InstructionSet get_instruction_set();
+
+    /**
+    * accumulates into 8 interleaved partial sums that are reduced in a fixed order,
+    * so every instruction set returns bit-identical results
+    */
+    float dot_product(const float* lhs, const float* rhs, size_t size);
+
+    /**
+    * scales signed 16-bit samples into [-1, 1)
+    */
+    void int16_to_float(const int16_t* input, float* output, size_t size);
+
+    /**
+    * averages interleaved channels into a mono signal, output holds frame_count samples
+    */
+    void downmix(const float* input, size_t frame_count, unsigned int channels, float* output);
+
+    /**
+    * output[i] = input[i] * window[i], output may alias input
+    */
+    void apply_window(const float* input, const float* window, float* output, size_t size);
+
+    /**
+    * output[i] = max(lhs[i], rhs[i]), output may alias either input. output may also be lhs while
+    * rhs points further into the same buffer, every element is read before it is overwritten
+    */
+    void maximum(const float* lhs, const float* rhs, float* output, size_t size);
+
+    void maximum(const int32_t* lhs, const int32_t* rhs, int32_t* output, size_t size);
+
+    /**
+    * windows a real signal into interleaved complex values with zero imaginary parts,
+    * output holds 2 * size floats
+    */
+    void apply_window_complex(const float* input, const float* window, float* output, size_t size);
+
+    /**
+    * re^2 + im^2 per bin, squared and summed in double so every instruction set returns the same floats
+    */
+    void power(const float* re, const float* im, float* output, size_t size);
+
+    /**
+    * sqrt(re^2 + im^2) per bin, computed in double, bit-identical to FreqBin on every instruction set
+    */
+    void magnitude(const float* re, const float* im, float* output, size_t size);
+
+    /**
+    * 20 * log10 of the magnitude, clamped to floor_db for silent bins
+    */
+    void magnitude_db(const float* re, const float* im, float* output, size_t size, float floor_db = -120.0f);
+
+}// namespace siren::simd
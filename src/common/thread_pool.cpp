@@ -0,0 +1,93 @@
+#include <algorithm>
+#include "thread_pool.h"
+
+namespace siren
+{
+
+    ThreadPool::ThreadPool(size_t thread_count)
+    {
+        thread_count = std::max<size_t>(thread_count, 1);
+        for (size_t i = 0; i < thread_count; i++)
+        {
+            m_threads.emplace_back(&ThreadPool::worker_loop, this, i);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stopping = true;
+        }
+        m_job_available.notify_all();
+        for (std::thread& thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    void ThreadPool::parallel_for(size_t count, const Body& body)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        auto job = std::make_shared<Job>();
+        job->body = &body;
+        job->count = count;
+
+        std::unique_lock lock(m_mutex);
+        m_jobs.push_back(job);
+        m_job_available.notify_all();
+        job->finished.wait(lock, [&job]()
+        {
+            return job->completed.load() == job->count;
+        });
+    }
+
+    void ThreadPool::worker_loop(size_t worker)
+    {
+        while (true)
+        {
+            std::shared_ptr<Job> job;
+            {
+                std::unique_lock lock(m_mutex);
+                m_job_available.wait(lock, [this]()
+                {
+                    return m_stopping || !m_jobs.empty();
+                });
+                if (m_jobs.empty())
+                {
+                    return;
+                }
+                job = m_jobs.front();
+            }
+
+            size_t index;
+            while ((index = job->next.fetch_add(1)) < job->count)
+            {
+                (*job->body)(index, worker);
+                if (job->completed.fetch_add(1) + 1 == job->count)
+                {
+                    std::lock_guard lock(m_mutex);
+                    job->finished.notify_all();
+                }
+            }
+
+            // every index is handed out, stop offering the job to idle workers
+            std::lock_guard lock(m_mutex);
+            auto it = std::find(m_jobs.begin(), m_jobs.end(), job);
+            if (it != m_jobs.end())
+            {
+                m_jobs.erase(it);
+            }
+        }
+    }
+
+    size_t ThreadPool::get_thread_count() const
+    {
+        return m_threads.size();
+    }
+
+}// namespace siren
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace siren
+{
+
+    /**
+    * fixed set of worker threads for splitting one piece of work (e.g. the frames of a single track)
+    * across cores, several threads may call parallel_for on the same pool at once
+    */
+    class ThreadPool
+    {
+    public:
+        using Body = std::function<void(size_t index, size_t worker)>;
+
+        explicit ThreadPool(size_t thread_count);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /**
+        * runs body for every index in [0, count) and blocks until all of them returned. worker is in
+        * [0, get_thread_count()) and never shared by two bodies running at the same time, so it can
+        * index per-thread state. must not be called from inside a body
+        */
+        void parallel_for(size_t count, const Body& body);
+
+        [[nodiscard]] size_t get_thread_count() const;
+
+    private:
+        struct Job
+        {
+            const Body* body;
+            size_t count;
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> completed{0};
+            std::condition_variable finished;
+        };
+
+        void worker_loop(size_t worker);
+
+    private:
+        std::vector<std::thread> m_threads;
+        std::deque<std::shared_ptr<Job>> m_jobs;
+        std::mutex m_mutex;
+        std::condition_variable m_job_available;
+        bool m_stopping{false};
+    };
+
+}// namespace siren
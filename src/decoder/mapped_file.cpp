@@ -0,0 +1,86 @@
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mapped_file.h"
+
+namespace siren::audio
+{
+
+    MappedFile::MappedFile(std::string path)
+        : m_path(std::move(path))
+    {
+    }
+
+    MappedFile::~MappedFile()
+    {
+        unmap();
+    }
+
+    bool MappedFile::map()
+    {
+        unmap();
+
+        int fd = open(m_path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat file_stat{};
+        if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0)
+        {
+            close(fd);
+            return false;
+        }
+
+        size_t size = file_stat.st_size;
+        void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // the mapping keeps its own reference to the file
+        close(fd);
+
+        if (data == MAP_FAILED)
+        {
+            return false;
+        }
+
+        // decoders read front to back, let the kernel read ahead aggressively
+        madvise(data, size, MADV_SEQUENTIAL);
+
+        m_data = data;
+        m_size = size;
+        return true;
+    }
+
+    void MappedFile::unmap()
+    {
+        if (m_data)
+        {
+            munmap(m_data, m_size);
+            m_data = nullptr;
+            m_size = 0;
+        }
+    }
+
+    bool MappedFile::is_mapped() const
+    {
+        return m_data != nullptr;
+    }
+
+    const void* MappedFile::get_data() const
+    {
+        return m_data;
+    }
+
+    size_t MappedFile::get_size() const
+    {
+        return m_size;
+    }
+
+    const std::string& MappedFile::get_path() const
+    {
+        return m_path;
+    }
+
+}// namespace siren::audio
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+namespace siren::audio
+{
+
+    /**
+    * read-only memory mapping of an encoded track, hand it to several PCM objects
+    * through a shared_ptr to decode the same file with different configurations
+    */
+    class MappedFile
+    {
+
+    public:
+        explicit MappedFile(std::string path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool map();
+
+        [[nodiscard]] bool is_mapped() const;
+        [[nodiscard]] const void* get_data() const;
+        [[nodiscard]] size_t get_size() const;
+        [[nodiscard]] const std::string& get_path() const;
+
+    private:
+        void unmap();
+
+    private:
+        std::string m_path;
+        void* m_data{nullptr};
+        size_t m_size{0};
+    };
+
+}// namespace siren::audio
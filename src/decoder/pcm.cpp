@@ -1,66 +1,398 @@
+#include <algorithm>
+#include <type_traits>
 #include <utility>
 #include <../miniaudio/miniaudio.h>
 #include "pcm.h"
+#include "../common/common.h"
+#include "../common/simd.h"
 
 namespace siren::audio
 {
 
+    void PCM::DecoderDeleter::operator()(ma_decoder* decoder) const
+    {
+        ma_decoder_uninit(decoder);
+        delete decoder;
+    }
+
     PCM::PCM(std::string path, unsigned int channels, unsigned int sampling_rate)
-        : m_track_path(std::move(path)), m_channels(channels), m_sampling_rate(sampling_rate)
+        : m_track_path(std::move(path)), m_sampling_rate(sampling_rate), m_channels(channels)
+    {
+    }
+
+    PCM::PCM(const void* data, size_t size, unsigned int channels, unsigned int sampling_rate)
+        : m_track_data(data), m_track_data_size(size), m_sampling_rate(sampling_rate), m_channels(channels)
+    {
+    }
+
+    PCM::PCM(std::shared_ptr<const MappedFile> file, unsigned int channels, unsigned int sampling_rate)
+        : m_track_path(file->get_path()),
+          m_track_data(file->get_data()),
+          m_track_data_size(file->get_size()),
+          m_mapped_file(std::move(file)),
+          m_sampling_rate(sampling_rate),
+          m_channels(channels)
+    {
+    }
+
+    PCM::PCM(unsigned int channels, unsigned int sampling_rate)
+        : m_sampling_rate(sampling_rate), m_channels(channels)
+    {
+    }
+
+    PCM::PCM(std::shared_ptr<const std::vector<float>> samples, unsigned int channels, unsigned int sampling_rate, float length_ms, const TimeRange& range)
+        : m_samples(std::move(samples)),
+          m_sampling_rate(sampling_rate),
+          m_channels(channels),
+          m_length_ms(length_ms),
+          m_range(range),
+          m_frame_count(m_samples->size())
     {
     }
 
     float PCM::operator[](size_t idx)
     {
-        return m_pcm[idx];
+        return *get_frames(idx, 1);
     }
 
-    bool PCM::config_decoder()
+    bool PCM::init_decoder()
     {
-        ma_result result;
-        ma_decoder decoder;
-        ma_decoder_config config = ma_decoder_config_init(ma_format_f32, m_channels, m_sampling_rate);
+        // the built-in resampler only handles mono, anything else stays with miniaudio's converter
+        bool resample = m_use_resampler && m_channels == 1;
+        ma_decoder_config config = ma_decoder_config_init(ma_format_f32, m_channels, resample ? 0 : m_sampling_rate);
 
-        result = ma_decoder_init_file(m_track_path.c_str(), &config, &decoder);
+        auto decoder = std::make_unique<ma_decoder>();
+        ma_result result = m_track_data
+            ? ma_decoder_init_memory(m_track_data, m_track_data_size, &config, decoder.get())
+            : ma_decoder_init_file(m_track_path.c_str(), &config, decoder.get());
         if (result != MA_SUCCESS)
         {
             return false;
         }
+        m_decoder = std::unique_ptr<ma_decoder, DecoderDeleter>(decoder.release());
+
+        float length;
+        ma_data_source_get_length_in_seconds(m_decoder.get(), &length);
+
+        unsigned int decoder_rate = m_decoder->outputSampleRate;
+        m_length_ms = length * 1000;
+        m_channels = m_decoder->outputChannels;
+        m_resampler.reset();
+        if (resample && decoder_rate != m_sampling_rate)
+        {
+            m_resampler = std::make_unique<Resampler>(decoder_rate, m_sampling_rate, m_resampler_quality);
+        }
+        m_sampling_rate = resample ? m_sampling_rate : decoder_rate;
 
         ma_uint64 available_frames = 0;
-        result = ma_decoder_get_available_frames(&decoder, &available_frames);
+        result = ma_decoder_get_available_frames(m_decoder.get(), &available_frames);
         if (result != MA_SUCCESS || available_frames == 0)
         {
+            m_decoder.reset();
             return false;
         }
+        m_decoder_frames = available_frames;
+        m_decoded_frames = 0;
+
+        if (m_range.start_ms == 0 && m_range.end_ms == 0)
+        {
+            return true;
+        }
+
+        ma_uint64 start_frame = (ma_uint64)m_range.start_ms * decoder_rate / 1000;
+        ma_uint64 end_frame = m_range.end_ms == 0 ? available_frames : (ma_uint64)m_range.end_ms * decoder_rate / 1000;
+        end_frame = std::min(end_frame, available_frames);
+
+        if (start_frame >= end_frame || ma_decoder_seek_to_pcm_frame(m_decoder.get(), start_frame) != MA_SUCCESS)
+        {
+            m_decoder.reset();
+            return false;
+        }
+
+        m_decoder_frames = end_frame - start_frame;
+        m_length_ms = (float)m_decoder_frames / decoder_rate * 1000;
+
+        return true;
+    }
+
+    void PCM::set_range(const TimeRange& range)
+    {
+        release_assert(range.is_valid(), "range.start_ms >= range.end_ms");
+        m_range = range;
+    }
+
+    void PCM::set_resampler(ResamplerQuality quality)
+    {
+        m_use_resampler = true;
+        m_resampler_quality = quality;
+    }
 
-        float* temp = new float[available_frames];
+    size_t PCM::decode_chunk(std::vector<float>& output)
+    {
+        size_t offset = output.size();
+        size_t frames = std::min(m_chunk_size, m_decoder_frames - m_decoded_frames);
         ma_uint64 frames_read = 0;
 
-        result = ma_data_source_read_pcm_frames(&decoder, temp, available_frames, &frames_read);
-        if (result != MA_SUCCESS || frames_read <= 0)
+        if (frames > 0)
+        {
+            float* target;
+            if (m_resampler)
+            {
+                m_native_chunk.resize(frames * m_channels);
+                target = m_native_chunk.data();
+            }
+            else
+            {
+                output.resize(offset + frames * m_channels);
+                target = output.data() + offset;
+            }
+            ma_data_source_read_pcm_frames(m_decoder.get(), target, frames, &frames_read);
+        }
+
+        if (frames_read == 0)
+        {
+            // some decoders only estimate their length, stop at whatever they actually produce
+            m_decoded_frames = m_decoder_frames;
+        }
+        m_decoded_frames += frames_read;
+
+        if (!m_resampler)
+        {
+            output.resize(offset + frames_read * m_channels);
+            return frames_read * m_channels;
+        }
+
+        if (frames_read > 0)
+        {
+            m_resampler->process(m_native_chunk.data(), frames_read, output);
+        }
+        if (m_decoded_frames == m_decoder_frames)
+        {
+            m_resampler->flush(output);
+        }
+        return output.size() - offset;
+    }
+
+    bool PCM::config_decoder()
+    {
+        if (!init_decoder())
         {
             return false;
         }
 
-        m_pcm = std::vector(temp, temp + frames_read);
+        // decode straight into the final buffer instead of going through a temporary copy
+        std::vector<float> samples;
+        samples.reserve(m_resampler ? m_resampler->get_output_count(m_decoder_frames) : m_decoder_frames * m_channels);
+        while (decode_chunk(samples) > 0)
+        {
+        }
 
-        float length;
-        ma_data_source_get_length_in_seconds(&decoder, &length);
+        m_decoder.reset();
+        m_resampler.reset();
+        m_native_chunk = std::vector<float>();
+        if (samples.empty())
+        {
+            return false;
+        }
+        m_frame_count = samples.size();
+        m_samples = std::make_shared<const std::vector<float>>(std::move(samples));
 
-        m_length_ms = length * 1000;
-        m_sampling_rate = decoder.outputSampleRate;
-        m_channels = decoder.outputChannels;
+        return true;
+    }
+
+    bool PCM::config_stream(size_t chunk_size)
+    {
+        release_assert(chunk_size > 0, "chunk_size must be positive");
+        m_chunk_size = chunk_size;
+        if (!init_decoder())
+        {
+            return false;
+        }
+
+        m_frame_count = m_resampler ? m_resampler->get_output_count(m_decoder_frames) : m_decoder_frames * m_channels;
+        m_buffer_offset = 0;
+        m_read_index = 0;
+        m_pcm.clear();
+        m_pcm.reserve(m_chunk_size * m_channels);
+
+        return true;
+    }
+
+    bool PCM::config_samples(const int16_t* samples, size_t frame_count, unsigned int channels, unsigned int sampling_rate)
+    {
+        return load_samples(samples, frame_count, channels, sampling_rate);
+    }
+
+    bool PCM::config_samples(const float* samples, size_t frame_count, unsigned int channels, unsigned int sampling_rate)
+    {
+        return load_samples(samples, frame_count, channels, sampling_rate);
+    }
+
+    template<typename Sample>
+    bool PCM::load_samples(const Sample* samples, size_t frame_count, unsigned int channels, unsigned int sampling_rate)
+    {
+        if (!samples || frame_count == 0 || channels == 0 || sampling_rate == 0)
+        {
+            return false;
+        }
+
+        unsigned int target_channels = m_channels == 0 ? channels : m_channels;
+        unsigned int target_rate = m_sampling_rate == 0 ? sampling_rate : m_sampling_rate;
+        bool downmix = target_channels != channels;
+        if (downmix && target_channels != 1)
+        {
+            return false;
+        }
+
+        size_t start_frame = (size_t)m_range.start_ms * sampling_rate / 1000;
+        size_t end_frame = m_range.end_ms == 0 ? frame_count : std::min<size_t>(frame_count, (size_t)m_range.end_ms * sampling_rate / 1000);
+        if (start_frame >= end_frame)
+        {
+            return false;
+        }
+        samples += start_frame * channels;
+        frame_count = end_frame - start_frame;
+
+        std::unique_ptr<Resampler> resampler;
+        if (target_rate != sampling_rate)
+        {
+            if (target_channels != 1)
+            {
+                return false;
+            }
+            resampler = std::make_unique<Resampler>(sampling_rate, target_rate, m_resampler_quality);
+        }
+
+        m_decoder.reset();
+        std::vector<float> converted_samples;
+        converted_samples.reserve(resampler ? resampler->get_output_count(frame_count) : frame_count * target_channels);
+
+        // converted in blocks so the scratch buffers stay small whatever the input length
+        constexpr size_t block_size = 4096;
+        std::vector<float> converted, mono;
+        for (size_t frame = 0; frame < frame_count; frame += block_size)
+        {
+            size_t frames = std::min(block_size, frame_count - frame);
+            const Sample* block = samples + frame * channels;
+
+            const float* interleaved;
+            if constexpr (std::is_same_v<Sample, int16_t>)
+            {
+                converted.resize(frames * channels);
+                simd::int16_to_float(block, converted.data(), frames * channels);
+                interleaved = converted.data();
+            }
+            else
+            {
+                interleaved = block;
+            }
+
+            const float* output = interleaved;
+            if (downmix)
+            {
+                mono.resize(frames);
+                simd::downmix(interleaved, frames, channels, mono.data());
+                output = mono.data();
+            }
+
+            if (resampler)
+            {
+                resampler->process(output, frames, converted_samples);
+            }
+            else
+            {
+                converted_samples.insert(converted_samples.end(), output, output + frames * target_channels);
+            }
+        }
+        if (resampler)
+        {
+            resampler->flush(converted_samples);
+        }
 
-        ma_decoder_uninit(&decoder);
-        delete[] temp;
+        m_channels = target_channels;
+        m_sampling_rate = target_rate;
+        m_length_ms = (float)frame_count / sampling_rate * 1000;
+        m_frame_count = converted_samples.size();
+        m_samples = std::make_shared<const std::vector<float>>(std::move(converted_samples));
 
         return true;
     }
 
+    void PCM::fill_stream_buffer(size_t offset, size_t count)
+    {
+        release_assert(offset >= m_buffer_offset, "streamed PCM cannot seek back past its buffer");
+
+        // decode through frames nobody asked for without keeping them around
+        while (m_buffer_offset + m_pcm.size() - m_read_index < offset)
+        {
+            m_buffer_offset += m_pcm.size() - m_read_index;
+            m_read_index = 0;
+            m_pcm.clear();
+            if (decode_chunk(m_pcm) == 0)
+            {
+                break;
+            }
+        }
+
+        // step over the frames already handed out instead of moving the tail each time
+        size_t consumed = std::min(offset - m_buffer_offset, m_pcm.size() - m_read_index);
+        m_read_index += consumed;
+        m_buffer_offset = offset;
+
+        while (m_pcm.size() - m_read_index < count)
+        {
+            // compact only once the buffer outgrows the window, so it never holds more than count plus one chunk
+            if (m_pcm.size() > count)
+            {
+                m_pcm.erase(m_pcm.begin(), m_pcm.begin() + m_read_index);
+                m_read_index = 0;
+            }
+            if (decode_chunk(m_pcm) == 0)
+            {
+                // length reported by some decoders is an estimate, pad the shortfall with silence
+                m_pcm.resize(m_read_index + count, 0.0f);
+            }
+        }
+    }
+
+    const float* PCM::get_frames(size_t offset, size_t count)
+    {
+        release_assert(offset + count <= m_frame_count, "requested frames exceed PCM length");
+        if (!m_decoder)
+        {
+            return m_samples->data() + offset;
+        }
+
+        if (offset < m_buffer_offset || offset + count > m_buffer_offset + m_pcm.size() - m_read_index)
+        {
+            fill_stream_buffer(offset, count);
+        }
+        return m_pcm.data() + m_read_index + (offset - m_buffer_offset);
+    }
+
+    std::shared_ptr<const std::vector<float>> PCM::get_samples() const
+    {
+        return m_samples;
+    }
+
+    unsigned int PCM::get_channel_count() const
+    {
+        return m_channels;
+    }
+
+    const TimeRange& PCM::get_range() const
+    {
+        return m_range;
+    }
+
+    bool PCM::is_streaming() const
+    {
+        return m_decoder != nullptr;
+    }
+
     size_t PCM::get_frame_count() const
     {
-        return m_pcm.size();
+        return m_frame_count;
     }
 
     float PCM::get_length_in_ms() const
@@ -68,9 +400,14 @@ namespace siren::audio
         return m_length_ms;
     }
 
+    size_t PCM::get_offset_in_ms() const
+    {
+        return m_range.start_ms;
+    }
+
     unsigned int PCM::get_sampling_rate() const
     {
         return m_sampling_rate;
     }
 
-}// namespace siren::audio
\ No newline at end of file
+}// namespace siren::audio
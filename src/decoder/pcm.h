@@ -1,30 +1,142 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
+#include <memory>
 #include <vector>
 
+#include "mapped_file.h"
+#include "resampler.h"
+
+struct ma_decoder;
+
 namespace siren::audio
 {
 
+    struct TimeRange
+    {
+        size_t start_ms = 0;
+        size_t end_ms = 0; // 0 decodes until the end of the track
+
+        /**
+        * a range has to end after it starts, set_range asserts on any other
+        */
+        [[nodiscard]] bool is_valid() const
+        {
+            return end_ms == 0 || start_ms < end_ms;
+        }
+    };
+
     class PCM
     {
+        struct DecoderDeleter
+        {
+            void operator()(ma_decoder* decoder) const;
+        };
 
     public:
         PCM(std::string path, unsigned int channels, unsigned int sampling_rate);
+
+        /**
+        * decodes an encoded track held in memory, the buffer is owned by the caller
+        * and has to outlive the PCM when it is used in streaming mode
+        */
+        PCM(const void* data, size_t size, unsigned int channels, unsigned int sampling_rate);
+
+        /**
+        * decodes from a memory-mapped file, the PCM keeps the mapping alive
+        */
+        PCM(std::shared_ptr<const MappedFile> file, unsigned int channels, unsigned int sampling_rate);
+
+        /**
+        * pcm without an encoded source, filled through config_samples
+        */
+        PCM(unsigned int channels, unsigned int sampling_rate);
+
+        /**
+        * wraps already decoded samples, e.g. from a PCMCache, without copying them
+        */
+        PCM(std::shared_ptr<const std::vector<float>> samples, unsigned int channels, unsigned int sampling_rate, float length_ms, const TimeRange& range = {});
+
         float operator[](size_t idx);
 
+        /**
+        * limits decoding to [start_ms, end_ms) of the track, has to be called before config_*
+        */
+        void set_range(const TimeRange& range);
+
+        /**
+        * decodes mono tracks at their native rate and converts them with the built-in
+        * polyphase resampler instead of miniaudio's converter, has to be called before config_*
+        */
+        void set_resampler(ResamplerQuality quality);
+
         bool config_decoder();
 
+        /**
+        * opens the decoder without decoding the whole track, frames are pulled
+        * in chunk_size pieces into a reusable buffer as get_frames walks forward
+        */
+        bool config_stream(size_t chunk_size = 65536);
+
+        /**
+        * takes raw interleaved samples instead of decoding, downmixes them to mono when the pcm
+        * was created with a single channel and resamples them when the rates differ
+        */
+        bool config_samples(const int16_t* samples, size_t frame_count, unsigned int channels, unsigned int sampling_rate);
+        bool config_samples(const float* samples, size_t frame_count, unsigned int channels, unsigned int sampling_rate);
+
+        /**
+        * returns a pointer to count contiguous samples starting at offset,
+        * in streaming mode offsets must not go back past the buffered frames
+        */
+        [[nodiscard]] const float* get_frames(size_t offset, size_t count);
+
+        /**
+        * decoded samples shared with the PCM, nullptr in streaming mode
+        */
+        [[nodiscard]] std::shared_ptr<const std::vector<float>> get_samples() const;
+
+        [[nodiscard]] bool is_streaming() const;
+        [[nodiscard]] unsigned int get_channel_count() const;
+        [[nodiscard]] const TimeRange& get_range() const;
         [[nodiscard]] float get_length_in_ms() const;
+        [[nodiscard]] size_t get_offset_in_ms() const;
         [[nodiscard]] size_t get_frame_count() const;
         [[nodiscard]] unsigned int get_sampling_rate() const;
 
     private:
+        bool init_decoder();
+        size_t decode_chunk(std::vector<float>& output);
+        void fill_stream_buffer(size_t offset, size_t count);
+
+        template<typename Sample>
+        bool load_samples(const Sample* samples, size_t frame_count, unsigned int channels, unsigned int sampling_rate);
+
+    private:
+        std::shared_ptr<const std::vector<float>> m_samples;
         std::vector<float> m_pcm;
         std::string m_track_path;
+        const void* m_track_data{nullptr};
+        size_t m_track_data_size{0};
+        std::shared_ptr<const MappedFile> m_mapped_file;
         unsigned int m_sampling_rate;
         unsigned int m_channels;
         float m_length_ms;
+        TimeRange m_range;
+
+        std::unique_ptr<ma_decoder, DecoderDeleter> m_decoder;
+        size_t m_decoder_frames{0};
+        size_t m_decoded_frames{0};
+        size_t m_chunk_size{65536};
+        size_t m_frame_count{0};
+        size_t m_buffer_offset{0};
+        size_t m_read_index{0};
+
+        bool m_use_resampler{false};
+        ResamplerQuality m_resampler_quality{ResamplerQuality::Medium};
+        std::unique_ptr<Resampler> m_resampler;
+        std::vector<float> m_native_chunk;
     };
 
-}// namespace siren::audio
\ No newline at end of file
+}// namespace siren::audio
@@ -0,0 +1,104 @@
+#include <filesystem>
+#include "pcm_cache.h"
+
+namespace siren::audio
+{
+
+    std::string PCMCacheKey::to_str() const
+    {
+        return path + '|' + std::to_string(file_size) + '|' + std::to_string(modified_at) + '|'
+               + std::to_string(sampling_rate) + '|' + std::to_string(channels) + '|'
+               + std::to_string(range.start_ms) + '|' + std::to_string(range.end_ms) + '|'
+               + (builtin_resampler ? std::to_string((int)resampler_quality) : "-");
+    }
+
+    PCMCache::PCMCache(size_t byte_budget)
+        : m_byte_budget(byte_budget)
+    {
+    }
+
+    bool PCMCache::make_key(const std::string& path, PCMCacheKey& key)
+    {
+        std::error_code ec;
+        auto file_size = std::filesystem::file_size(path, ec);
+        if (ec)
+        {
+            return false;
+        }
+        auto modified_at = std::filesystem::last_write_time(path, ec);
+        if (ec)
+        {
+            return false;
+        }
+
+        key.path = path;
+        key.file_size = file_size;
+        key.modified_at = modified_at.time_since_epoch().count();
+        return true;
+    }
+
+    std::unique_ptr<PCM> PCMCache::find(const PCMCacheKey& key)
+    {
+        std::lock_guard lock(m_mutex);
+        auto it = m_index.find(key.to_str());
+        if (it == m_index.end())
+        {
+            return nullptr;
+        }
+
+        // move to the front, the back is evicted first
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        const Entry& entry = *it->second;
+        return std::make_unique<PCM>(entry.samples, entry.channels, entry.sampling_rate, entry.length_ms, entry.range);
+    }
+
+    void PCMCache::insert(const PCMCacheKey& key, const PCM& pcm)
+    {
+        auto samples = pcm.get_samples();
+        if (!samples)
+        {
+            return;
+        }
+        size_t bytes = samples->size() * sizeof(float);
+        if (bytes > m_byte_budget)
+        {
+            return;
+        }
+
+        std::lock_guard lock(m_mutex);
+        std::string str_key = key.to_str();
+        if (m_index.count(str_key))
+        {
+            return;
+        }
+
+        evict(bytes);
+        m_entries.push_front({str_key, std::move(samples), pcm.get_channel_count(), pcm.get_sampling_rate(), pcm.get_length_in_ms(), pcm.get_range()});
+        m_index.emplace(std::move(str_key), m_entries.begin());
+        m_size_in_bytes += bytes;
+    }
+
+    void PCMCache::evict(size_t required_bytes)
+    {
+        while (!m_entries.empty() && m_size_in_bytes + required_bytes > m_byte_budget)
+        {
+            const Entry& entry = m_entries.back();
+            m_size_in_bytes -= entry.samples->size() * sizeof(float);
+            m_index.erase(entry.key);
+            m_entries.pop_back();
+        }
+    }
+
+    size_t PCMCache::get_size_in_bytes() const
+    {
+        std::lock_guard lock(m_mutex);
+        return m_size_in_bytes;
+    }
+
+    size_t PCMCache::get_entry_count() const
+    {
+        std::lock_guard lock(m_mutex);
+        return m_entries.size();
+    }
+
+}// namespace siren::audio
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "pcm.h"
+
+namespace siren::audio
+{
+
+    /**
+    * identifies a decoded track: the file (path, size, mtime) and every setting that changes the samples
+    */
+    struct PCMCacheKey
+    {
+        std::string path;
+        uintmax_t file_size = 0;
+        int64_t modified_at = 0;
+        unsigned int sampling_rate = 0;
+        unsigned int channels = 0;
+        TimeRange range;
+        bool builtin_resampler = false;
+        ResamplerQuality resampler_quality = ResamplerQuality::Medium;
+
+        [[nodiscard]] std::string to_str() const;
+    };
+
+    /**
+    * thread-safe lru cache of decoded samples bounded by a byte budget,
+    * hits share the cached buffer with the returned PCM instead of copying it
+    */
+    class PCMCache
+    {
+        struct Entry
+        {
+            std::string key;
+            std::shared_ptr<const std::vector<float>> samples;
+            unsigned int channels;
+            unsigned int sampling_rate;
+            float length_ms;
+            TimeRange range;
+        };
+
+    public:
+        explicit PCMCache(size_t byte_budget);
+
+        /**
+        * fills in the file identity part of key, returns false when the file cannot be stat'ed
+        */
+        static bool make_key(const std::string& path, PCMCacheKey& key);
+
+        [[nodiscard]] std::unique_ptr<PCM> find(const PCMCacheKey& key);
+
+        /**
+        * stores a fully decoded PCM, streaming PCMs and tracks larger than the budget are ignored
+        */
+        void insert(const PCMCacheKey& key, const PCM& pcm);
+
+        [[nodiscard]] size_t get_size_in_bytes() const;
+        [[nodiscard]] size_t get_entry_count() const;
+
+    private:
+        void evict(size_t required_bytes);
+
+    private:
+        size_t m_byte_budget;
+        size_t m_size_in_bytes{0};
+        std::list<Entry> m_entries;
+        std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+        mutable std::mutex m_mutex;
+    };
+
+}// namespace siren::audio
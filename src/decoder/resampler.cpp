@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include "resampler.h"
+#include "../common/common.h"
+#include "../common/simd.h"
+
+namespace siren::audio
+{
+
+    namespace
+    {
+        double bessel_i0(double x)
+        {
+            double sum = 1.0;
+            double term = 1.0;
+            for (int k = 1; k < 32; k++)
+            {
+                term *= (x / (2.0 * k)) * (x / (2.0 * k));
+                sum += term;
+            }
+            return sum;
+        }
+    }// namespace
+
+    Resampler::Resampler(unsigned int input_rate, unsigned int output_rate, ResamplerQuality quality)
+        : m_input_rate(input_rate), m_output_rate(output_rate)
+    {
+        release_assert(input_rate > 0 && output_rate > 0, "resampler rates must be positive");
+        uint64_t divisor = std::gcd(input_rate, output_rate);
+        m_up = output_rate / divisor;
+        m_down = input_rate / divisor;
+
+        config_filter_bank(quality);
+
+        // centers the first output on the first input sample
+        m_buffer.assign(m_taps / 2 - 1, 0.0f);
+    }
+
+    void Resampler::config_filter_bank(ResamplerQuality quality)
+    {
+        double rolloff, beta;
+        switch (quality)
+        {
+        case ResamplerQuality::Fast:
+            m_taps = 16;
+            rolloff = 0.85;
+            beta = 6.0;
+            break;
+        case ResamplerQuality::Medium:
+        default:
+            m_taps = 32;
+            rolloff = 0.9;
+            beta = 8.0;
+            break;
+        case ResamplerQuality::Best:
+            m_taps = 64;
+            rolloff = 0.94;
+            beta = 10.0;
+            break;
+        }
+
+        // cutoff in cycles per input sample, below the nyquist of the slower rate
+        double cutoff = 0.5 * rolloff * std::min(1.0, (double)m_up / m_down);
+        double half_width = m_taps / 2.0;
+        double pad = m_taps / 2.0 - 1.0;
+
+        m_filter_bank.resize(m_up * m_taps);
+        std::vector<double> kernel(m_taps);
+        for (size_t phase = 0; phase < m_up; phase++)
+        {
+            float* coeffs = m_filter_bank.data() + phase * m_taps;
+            double sum = 0.0;
+            for (size_t k = 0; k < m_taps; k++)
+            {
+                double t = k - pad - (double)phase / m_up;
+                double x = 2.0 * cutoff * t;
+                double sinc = x == 0.0 ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+                double ratio = std::min(1.0, std::abs(t) / half_width);
+                double window = bessel_i0(beta * std::sqrt(1.0 - ratio * ratio)) / bessel_i0(beta);
+                kernel[k] = sinc * window;
+                sum += kernel[k];
+            }
+            for (size_t k = 0; k < m_taps; k++)
+            {
+                coeffs[k] = static_cast<float>(kernel[k] / sum);
+            }
+        }
+    }
+
+    void Resampler::process(const float* input, size_t count, std::vector<float>& output)
+    {
+        m_buffer.insert(m_buffer.end(), input, input + count);
+        m_input_count += count;
+        resample(output, std::numeric_limits<size_t>::max());
+    }
+
+    void Resampler::flush(std::vector<float>& output)
+    {
+        size_t expected = get_output_count(m_input_count);
+        if (m_output_count >= expected)
+        {
+            return;
+        }
+        m_buffer.insert(m_buffer.end(), m_taps, 0.0f);
+        resample(output, expected - m_output_count);
+    }
+
+    void Resampler::resample(std::vector<float>& output, size_t limit)
+    {
+        if (m_buffer.size() < m_taps)
+        {
+            return;
+        }
+
+        // output at time t (in 1/up input samples) reads m_taps inputs from buffer index t / up - base
+        uint64_t last_time = (m_buffer.size() - m_taps + m_buffer_base) * m_up + m_up - 1;
+        if (last_time < m_time)
+        {
+            return;
+        }
+        size_t count = std::min<uint64_t>((last_time - m_time) / m_down + 1, limit);
+
+        size_t offset = output.size();
+        output.resize(offset + count);
+        float* out = output.data() + offset;
+
+        if (m_up == 1)
+        {
+            const float* input = m_buffer.data() + (m_time - m_buffer_base);
+            for (size_t i = 0; i < count; i++, input += m_down)
+            {
+                out[i] = simd::dot_product(m_filter_bank.data(), input, m_taps);
+            }
+        }
+        else
+        {
+            uint64_t time = m_time;
+            for (size_t i = 0; i < count; i++, time += m_down)
+            {
+                const float* coeffs = m_filter_bank.data() + (time % m_up) * m_taps;
+                out[i] = simd::dot_product(coeffs, m_buffer.data() + (time / m_up - m_buffer_base), m_taps);
+            }
+        }
+
+        m_time += count * m_down;
+        m_output_count += count;
+
+        // drop the inputs no later output can reach
+        size_t consumed = std::min<uint64_t>(m_time / m_up - m_buffer_base, m_buffer.size());
+        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + consumed);
+        m_buffer_base += consumed;
+    }
+
+    size_t Resampler::get_output_count(size_t input_count) const
+    {
+        return (input_count * m_up + m_down - 1) / m_down;
+    }
+
+    unsigned int Resampler::get_input_rate() const
+    {
+        return m_input_rate;
+    }
+
+    unsigned int Resampler::get_output_rate() const
+    {
+        return m_output_rate;
+    }
+
+}// namespace siren::audio
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace siren::audio
+{
+    enum class ResamplerQuality
+    {
+        Fast,
+        Medium,
+        Best
+    };
+
+    /**
+    * polyphase windowed-sinc resampler for mono pcm, fed in chunks of any size.
+    * the rate ratio is reduced to up/down integers, a ratio with up == 1 (e.g. 44100 -> 11025)
+    * takes a plain decimation path without any phase bookkeeping
+    */
+    class Resampler
+    {
+
+    public:
+        Resampler(unsigned int input_rate, unsigned int output_rate, ResamplerQuality quality = ResamplerQuality::Medium);
+
+        /**
+        * appends every output sample that can already be computed from the input seen so far
+        */
+        void process(const float* input, size_t count, std::vector<float>& output);
+
+        /**
+        * appends the remaining output once the input is exhausted
+        */
+        void flush(std::vector<float>& output);
+
+        [[nodiscard]] size_t get_output_count(size_t input_count) const;
+        [[nodiscard]] unsigned int get_input_rate() const;
+        [[nodiscard]] unsigned int get_output_rate() const;
+
+    private:
+        void config_filter_bank(ResamplerQuality quality);
+        void resample(std::vector<float>& output, size_t limit);
+
+    private:
+        unsigned int m_input_rate;
+        unsigned int m_output_rate;
+        uint64_t m_up;
+        uint64_t m_down;
+        size_t m_taps;
+
+        std::vector<float> m_filter_bank;
+        std::vector<float> m_buffer;
+        uint64_t m_time{0};
+        uint64_t m_buffer_base{0};
+        uint64_t m_input_count{0};
+        uint64_t m_output_count{0};
+    };
+
+}// namespace siren::audio
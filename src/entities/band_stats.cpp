@@ -0,0 +1,106 @@
+#include "band_stats.h"
+
+namespace siren
+{
+
+    std::vector<unsigned int> log_distribution(size_t end_index, size_t bands)
+    {
+        double scale = end_index / log(1.0 + bands);
+        std::vector<unsigned int> intervals;
+        for (int i = bands - 1; i >= 0; i--)
+        {
+            int upper_bound = log(2.0 + i) * scale;
+            intervals.push_back(end_index - upper_bound);
+        }
+        intervals.push_back(end_index);
+        return intervals;
+    }
+
+    std::vector<std::pair<size_t, size_t>> log_band_ranges(const std::vector<size_t>& bin_frequencies, size_t rows, size_t bands)
+    {
+        auto distribution = log_distribution(rows, bands);
+
+        std::vector<std::pair<size_t, size_t>> ranges;
+        size_t band_start = 0;
+        for (size_t i = 0; i < distribution.size() - 1; i++)
+        {
+            // bins are sorted by frequency, so every band of rows is a contiguous range of bins
+            while (band_start < bin_frequencies.size() && bin_frequencies[band_start] < distribution[i])
+            {
+                band_start++;
+            }
+            size_t band_end = band_start;
+            while (band_end < bin_frequencies.size() && bin_frequencies[band_end] < distribution[i + 1])
+            {
+                band_end++;
+            }
+            ranges.emplace_back(band_start, band_end);
+            band_start = band_end;
+        }
+        return ranges;
+    }
+
+    BandThreshold::BandThreshold(float zscore, StatsEngine engine)
+        : m_zscore(zscore), m_engine(engine), m_fixed_threshold(std::llround((double)zscore * 10000))
+    {
+    }
+
+    void BandThreshold::fit(std::vector<float>& values)
+    {
+        if (m_engine == StatsEngine::Sort)
+        {
+            m_median = get_median(values);
+            m_mad = get_mad(values, m_median);
+        }
+        else
+        {
+            m_median = select_median(values);
+            m_mad = select_mad(values, m_median, m_deviations);
+        }
+    }
+
+    void BandThreshold::fit(std::vector<int32_t>& values)
+    {
+        // magnitudes are never negative, so every deviation fits in an int32 as well
+        if (m_engine == StatsEngine::Sort)
+        {
+            m_fixed_median = 0;
+            m_fixed_mad = 0;
+            if (values.empty())
+            {
+                return;
+            }
+            std::sort(values.begin(), values.end());
+            m_fixed_median = values[values.size() / 2];
+            m_fixed_deviations.resize(values.size());
+            std::transform(values.begin(), values.end(), m_fixed_deviations.begin(), [&](int32_t value)
+            {
+                return static_cast<int32_t>(std::abs(value - m_fixed_median));
+            });
+            std::sort(m_fixed_deviations.begin(), m_fixed_deviations.end());
+            m_fixed_mad = m_fixed_deviations[m_fixed_deviations.size() / 2];
+        }
+        else
+        {
+            m_fixed_median = select_median(values);
+            m_fixed_mad = select_mad(values, static_cast<int32_t>(m_fixed_median), m_fixed_deviations);
+        }
+    }
+
+    bool BandThreshold::is_peak(float value) const
+    {
+        return get_zscore_of_peak(m_median, m_mad, value) >= m_zscore;
+    }
+
+    bool BandThreshold::is_peak(int32_t value) const
+    {
+        // a zero mad makes the float z-score inf or nan, which get_zscore_of_peak maps to 0
+        if (m_fixed_mad == 0)
+        {
+            return 0 >= m_zscore;
+        }
+        // 0.6745 * (point - median) / mad >= zscore, scaled by 1e4 on both sides
+        return (value - m_fixed_median) * 6745 >= m_fixed_threshold * m_fixed_mad;
+    }
+
+}// namespace siren
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace siren
+{
+
+    /**
+    * Sort is the original full sort of every band, Select finds the same order statistics
+    * with nth_element in place and gives identical results in linear time
+    */
+    enum class StatsEngine
+    {
+        Sort,
+        Select
+    };
+
+    template<typename T>
+    double get_median(std::vector<T> dist)
+    {
+        if (dist.empty())
+        {
+            return 0;
+        }
+        std::sort(dist.begin(), dist.end());
+        return dist[dist.size()/2];
+    }
+
+    template<typename T>
+    double get_mad(std::vector<T> dist, double median)
+    {
+        if (dist.empty())
+        {
+            return 0;
+        }
+
+        size_t size = dist.size();
+
+        std::vector<double> deviations(size);
+        std::transform(dist.begin(), dist.end(), deviations.begin(),
+        [&](T x)
+        {
+            return std::abs(x - median);
+        });
+
+        std::sort(deviations.begin(), deviations.end());
+        return deviations[size/2];
+    }
+
+    /**
+    * element at size/2 of the sorted dist, as get_median, dist is reordered
+    */
+    template<typename T>
+    T select_median(std::vector<T>& dist)
+    {
+        if (dist.empty())
+        {
+            return 0;
+        }
+        auto middle = dist.begin() + dist.size()/2;
+        std::nth_element(dist.begin(), middle, dist.end());
+        return *middle;
+    }
+
+    /**
+    * same value as get_mad, deviations is scratch space that keeps its capacity between calls
+    */
+    template<typename T, typename D>
+    D select_mad(const std::vector<T>& dist, D median, std::vector<D>& deviations)
+    {
+        if (dist.empty())
+        {
+            return 0;
+        }
+
+        deviations.resize(dist.size());
+        std::transform(dist.begin(), dist.end(), deviations.begin(),
+        [&](T x)
+        {
+            return std::abs(x - median);
+        });
+        return select_median(deviations);
+    }
+
+    template<typename T>
+    double get_zscore_of_peak(double median, double mad, T point)
+    {
+        double z_score = 0.6745 * ((point - median) / mad);
+        if (std::isnan(z_score) || std::isinf(z_score))
+        {
+            z_score = 0;
+        }
+        return z_score;
+    }
+
+    /**
+    * band edges in Hz rows, log spaced so that low frequencies get narrower bands
+    */
+    std::vector<unsigned int> log_distribution(size_t end_index, size_t bands);
+
+    /**
+    * [begin, end) bin ranges of the log bands, bin_frequencies has to be ascending
+    */
+    std::vector<std::pair<size_t, size_t>> log_band_ranges(const std::vector<size_t>& bin_frequencies, size_t rows, size_t bands);
+
+    /**
+    * z-score threshold of one frequency band, fitted on the band's magnitudes. float magnitudes
+    * use get_zscore_of_peak, Q15 int32 magnitudes from a fixed-point fft keep median, mad and
+    * the z-score test in integers, see is_peak. fit and is_peak have to be called with the same type
+    */
+    class BandThreshold
+    {
+    public:
+        explicit BandThreshold(float zscore, StatsEngine engine = StatsEngine::Select);
+
+        /**
+        * values may be reordered
+        */
+        void fit(std::vector<float>& values);
+        void fit(std::vector<int32_t>& values);
+
+        [[nodiscard]] bool is_peak(float value) const;
+
+        /**
+        * integer equivalent of get_zscore_of_peak(median, mad, value) >= zscore, with the threshold rounded to 1e-4
+        */
+        [[nodiscard]] bool is_peak(int32_t value) const;
+
+    private:
+        float m_zscore;
+        StatsEngine m_engine;
+        double m_median{0};
+        double m_mad{0};
+        int64_t m_fixed_median{0};
+        int64_t m_fixed_mad{0};
+        int64_t m_fixed_threshold;
+        std::vector<int32_t> m_fixed_deviations;
+        std::vector<double> m_deviations;
+    };
+
+}// namespace siren
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <iostream>
 #include <string>
 #include <unordered_map>
@@ -131,7 +133,7 @@ namespace siren
         template<typename Spec = siren::PeakSpectrogram>
         CoreStatus make_fingerprint(Spec&& spectrogram, size_t block_size, size_t min_peak_count, float stride_coeff=0.5)
         {
-            Eigen::SparseMatrix<float, Eigen::RowMajor> space = spectrogram.get_peak_spec_view();
+            const Eigen::SparseMatrix<float, Eigen::RowMajor>& space = spectrogram.get_peak_spec_view();
             if (space.nonZeros() < min_peak_count)
             {
                 return CoreStatus::PeaksTooSparse;
@@ -147,26 +149,22 @@ namespace siren
                 return CoreStatus::CoreParamsLogicError;
             }
 
-            auto hash_block = [this](Eigen::SparseMatrix<float, Eigen::RowMajor>&& block, int ioffset, int joffset)
+            // spectrogram columns are relative to the decoded range, stored timestamps are absolute
+            const size_t time_offset = spectrogram.get_time_offset();
+            const int64_t reach = block_size / 5;
+
+            auto hash_block = [this, time_offset, reach](const std::vector<std::array<int64_t, 2>>& points)
             {
-                if (block.nonZeros() < 3)
+                if (points.size() < 3)
                 {
                     return;
                 }
-                std::vector<std::array<int64_t, 2>> points;
-                for (size_t i = 0; i < block.outerSize(); i++)
-                {
-                    for (auto it = Eigen::SparseMatrix<float, Eigen::RowMajor>::InnerIterator(block, i); it; ++it)
-                    {
-                        points.push_back({it.row() + ioffset, it.col() + joffset});
-                    }
-                }
 
                 KDTree<int64_t, 2> tree(points);
                 for (size_t i = 0; i < points.size() - 3; i++)
                 {
                     std::array<int64_t, 2> anchor_point = points[i];
-                    auto cluster = tree.nearest_neighbors({anchor_point[0], anchor_point[1] + block.cols()/5});
+                    auto cluster = tree.nearest_neighbors({anchor_point[0], anchor_point[1] + reach});
                     cluster.erase(anchor_point);
 
                     if (cluster.size() < 3)
@@ -192,16 +190,42 @@ namespace siren
                             abs(anchor_point[1] - second[1]),
                             abs(anchor_point[1] - third[1]),
                         };
-                    m_fingerprint.emplace(anchor.hash(), anchor_point[1]);
+                    m_fingerprint.emplace(anchor.hash(), anchor_point[1] + time_offset);
+                }
+            };
+
+            // the peaks are walked once in (row, col) order instead of copying a sparse block per step
+            std::vector<std::array<int64_t, 2>> peaks;
+            peaks.reserve(space.nonZeros());
+            for (Eigen::Index i = 0; i < space.outerSize(); i++)
+            {
+                for (auto it = Eigen::SparseMatrix<float, Eigen::RowMajor>::InnerIterator(space, i); it; ++it)
+                {
+                    peaks.push_back({it.row(), it.col()});
                 }
+            }
+
+            auto by_col = [](const std::array<int64_t, 2>& lhs, const std::array<int64_t, 2>& rhs)
+            {
+                return std::make_pair(lhs[1], lhs[0]) < std::make_pair(rhs[1], rhs[0]);
             };
 
+            std::vector<std::array<int64_t, 2>> band;
+            std::vector<std::array<int64_t, 2>> points;
             for (size_t i = 0; i < space.rows() - block_size; i += floor(block_size*stride_coeff))
             {
+                auto band_begin = std::lower_bound(peaks.begin(), peaks.end(), std::array<int64_t, 2>{(int64_t)i, 0});
+                auto band_end = std::lower_bound(band_begin, peaks.end(), std::array<int64_t, 2>{(int64_t)(i + block_size), 0});
+                band.assign(band_begin, band_end);
+                std::sort(band.begin(), band.end(), by_col);
+
                 for (size_t j = 0; j < space.cols() - block_size; j += floor(block_size*stride_coeff))
                 {
-                    Eigen::SparseMatrix<float, Eigen::RowMajor> block = space.block(i, j, block_size, block_size);
-                    hash_block(std::move(block), i, j);
+                    auto block_begin = std::lower_bound(band.begin(), band.end(), std::array<int64_t, 2>{0, (int64_t)j}, by_col);
+                    auto block_end = std::lower_bound(block_begin, band.end(), std::array<int64_t, 2>{0, (int64_t)(j + block_size)}, by_col);
+                    points.assign(block_begin, block_end);
+                    std::sort(points.begin(), points.end());
+                    hash_block(points);
                 }
             }
             return CoreStatus::OK;
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <limits>
+#include "max_filter.h"
+#include "../common/simd.h"
+
+namespace siren
+{
+    namespace
+    {
+        template<typename T>
+        constexpr T s_padding = std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+
+        template<typename T>
+        void filter_row(const T* row, size_t bins, size_t radius, T* output, std::vector<T>& span)
+        {
+            // the row is padded by radius on each side, so the window of padded element i is [i, i + width).
+            // every pass doubles length, after it span[i] is the maximum of [i, i + length) for all i that
+            // are still needed, and two overlapping spans cover the whole window
+            const size_t width = 2 * radius + 1;
+            const size_t padded = bins + 2 * radius;
+            std::fill_n(span.begin(), radius, s_padding<T>);
+            std::copy_n(row, bins, span.begin() + radius);
+            std::fill_n(span.begin() + radius + bins, radius, s_padding<T>);
+
+            size_t length = 1;
+            for (; length * 2 <= width; length *= 2)
+            {
+                simd::maximum(span.data(), span.data() + length, span.data(), padded - 2 * length + 1);
+            }
+            simd::maximum(span.data(), span.data() + width - length, output, bins);
+        }
+    }// namespace
+
+    template<typename T>
+    void MaxFilter2D::apply(const T* input, size_t frames, size_t bins, size_t frame_radius, size_t bin_radius, T* output)
+    {
+        // the frame axis runs the filter_row recurrence with whole bin-filtered frames as elements.
+        // output frame f joins the suffix maximum of padded frame f within its block and the prefix
+        // maximum of padded frame f + width - 1, which lies in the same or the next block, so only
+        // the suffixes of one block and a single running prefix are held at any time
+        const size_t width = 2 * frame_radius + 1;
+        const size_t padded = frames + 2 * frame_radius;
+        std::vector<T> suffix(width * bins);
+        std::vector<T> prefix(bins);
+        std::vector<T> row(bins);
+        std::vector<T> span(bins + 2 * bin_radius);
+
+        // bin-filtered padded frame, recomputed from the input instead of stored for all frames
+        auto load = [&](size_t p_idx, T* dst)
+        {
+            if (p_idx < frame_radius || p_idx >= frame_radius + frames)
+            {
+                std::fill_n(dst, bins, s_padding<T>);
+                return;
+            }
+            filter_row(input + (p_idx - frame_radius) * bins, bins, bin_radius, dst, span);
+        };
+
+        size_t suffix_block = padded;
+        size_t prefix_end = 0;
+        for (size_t f_idx = 0; f_idx < frames; f_idx++)
+        {
+            const size_t block = f_idx / width;
+            if (block != suffix_block)
+            {
+                const size_t block_start = block * width;
+                const size_t block_end = std::min(block_start + width, padded);
+                for (size_t p_idx = block_end; p_idx-- > block_start;)
+                {
+                    T* dst = suffix.data() + (p_idx - block_start) * bins;
+                    load(p_idx, dst);
+                    if (p_idx + 1 < block_end)
+                    {
+                        simd::maximum(dst + bins, dst, dst, bins);
+                    }
+                }
+                suffix_block = block;
+            }
+
+            for (; prefix_end < f_idx + width; prefix_end++)
+            {
+                if (prefix_end % width == 0)
+                {
+                    load(prefix_end, prefix.data());
+                }
+                else
+                {
+                    load(prefix_end, row.data());
+                    simd::maximum(prefix.data(), row.data(), prefix.data(), bins);
+                }
+            }
+
+            simd::maximum(suffix.data() + (f_idx - block * width) * bins, prefix.data(), output + f_idx * bins, bins);
+        }
+    }
+
+    template void MaxFilter2D::apply(const float*, size_t, size_t, size_t, size_t, float*);
+    template void MaxFilter2D::apply(const int32_t*, size_t, size_t, size_t, size_t, int32_t*);
+
+}// namespace siren
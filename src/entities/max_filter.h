@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace siren
+{
+
+    /**
+    * maximum over frames [f - frame_radius, f + frame_radius] and bins [b - bin_radius, b + bin_radius]
+    * of a frame-major buffer, clipped at the edges. van Herk on the frame axis, span doubling on the bins
+    */
+    class MaxFilter2D
+    {
+    public:
+        template<typename T>
+        void apply(const T* input, size_t frames, size_t bins, size_t frame_radius, size_t bin_radius, T* output);
+    };
+
+}// namespace siren
@@ -1,12 +1,83 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string_view>
 #include "spectrogram.h"
+#include "../common/simd.h"
 
 namespace siren
 {
+    namespace
+    {
+        /**
+        * layout of a cache file: the header, the key, the bin frequencies and frame timestamps as uint64,
+        * the magnitudes as float or, for fixed-point spectrograms, Q15 int32 and the peaks as uint32 (row, col) pairs. every section starts
+        * on an 8 byte boundary, so all of them can be read in place from a mapping
+        */
+        struct SpectrogramFileHeader
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t flags;
+            uint64_t key_size;
+            uint64_t sampling_rate;
+            uint64_t window_size;
+            uint64_t hop_size;
+            uint64_t time_offset;
+            uint64_t rows;
+            uint64_t cols;
+            uint64_t frame_count;
+            uint64_t bin_count;
+            uint64_t magnitude_count;
+            uint64_t peak_count;
+            uint64_t run_count;
+            float time_resolution;
+            float freq_resolution;
+        };
 
-    Spectrogram::Spectrogram(std::unique_ptr<siren::audio::PCM> pcm, std::unique_ptr<siren::FFT> fft)
-        : m_fft_core(std::move(fft)),
-          m_pcm(std::move(pcm)),
-          m_window_size(m_fft_core->get_window_size())
+        constexpr char s_file_magic[8] = {'S', 'I', 'R', 'E', 'N', 'S', 'P', 'C'};
+        constexpr uint32_t s_file_version = 2;
+        constexpr uint32_t s_fixed_point_flag = 1;
+
+        void process_magnitudes(siren::FFT& fft, const float* const* frames, size_t count, float* magnitude)
+        {
+            fft.process_magnitudes(frames, count, magnitude);
+        }
+
+        void process_magnitudes(siren::FFT& fft, const float* const* frames, size_t count, int32_t* magnitude)
+        {
+            fft.process_magnitudes_fixed(frames, count, magnitude);
+        }
+
+        size_t align_section(size_t size)
+        {
+            return (size + 7) & ~size_t(7);
+        }
+    }// namespace
+
+    Spectrogram::Spectrogram()
+        : m_rows(0),
+          m_cols(0),
+          m_sampling_rate(0),
+          m_window_size(0),
+          m_hop_size(0),
+          m_window_counter(0),
+          m_time_resolution(0),
+          m_freq_resolution(0),
+          m_nyquist_component(0),
+          m_time_offset(0),
+          m_fixed_point(false)
+    {
+    }
+
+    Spectrogram::Spectrogram(std::unique_ptr<siren::audio::PCM> pcm, std::unique_ptr<siren::FFT> fft, ThreadPool* thread_pool, size_t hop_size, const Filterbank* filterbank,
+                             float silence_threshold)
+        : m_pcm(std::move(pcm)),
+          m_fft_core(std::move(fft)),
+          m_window_size(m_fft_core->get_window_size()),
+          m_hop_size(hop_size),
+          m_time_offset(m_pcm->get_offset_in_ms()),
+          m_fixed_point(m_fft_core->is_fixed_point())
     {
 
         set_sampling_rate();
@@ -16,17 +87,22 @@ namespace siren
         set_freq_resolution();
         init_spectrogram();
 
-        make_linear_spectrogram();
+        make_linear_spectrogram(thread_pool, filterbank, silence_threshold);
+    }
+
+    float Spectrogram::get_time_resolution() const
+    {
+        return m_time_resolution;
     }
 
-    const Eigen::SparseMatrix<float, Eigen::RowMajor>& Spectrogram::get_spectrogram_view() const
+    size_t Spectrogram::get_time_offset() const
     {
-        return m_spectrogram;
+        return m_time_offset;
     }
 
-    float Spectrogram::get_time_resolution() const
+    bool Spectrogram::is_fixed_point() const
     {
-        return m_time_resolution;
+        return m_fixed_point;
     }
 
     float Spectrogram::get_freq_resolution() const
@@ -34,42 +110,222 @@ namespace siren
         return m_freq_resolution;
     }
 
-    void Spectrogram::make_linear_spectrogram()
+    size_t Spectrogram::get_window_start(size_t window_idx) const
     {
-        std::vector<Triplet> triplet_list;
-        for (size_t frame_idx = 0; frame_idx < m_pcm->get_frame_count() - m_window_size / 2; frame_idx += m_window_size)
+        if (m_hop_size)
         {
-            std::vector<float> window(m_window_size);
-            for (size_t w_idx = 0; w_idx < m_window_size; w_idx++)
+            return window_idx * m_hop_size;
+        }
+        // legacy framing, windows are centred on multiples of the window size
+        return window_idx == 0 ? 0 : window_idx * m_window_size - m_window_size / 2;
+    }
+
+    size_t Spectrogram::get_window_position(size_t window_idx) const
+    {
+        if (m_hop_size)
+        {
+            return window_idx * m_hop_size + m_window_size / 2;
+        }
+        return window_idx * m_window_size;
+    }
+
+    size_t Spectrogram::get_window_count() const
+    {
+        const size_t frame_count = m_pcm->get_frame_count();
+        if (m_hop_size)
+        {
+            return frame_count < m_window_size ? 0 : (frame_count - m_window_size) / m_hop_size + 1;
+        }
+        if (frame_count < m_window_size / 2)
+        {
+            return 0;
+        }
+        const size_t frame_end = frame_count - m_window_size / 2;
+        return (frame_end + m_window_size - 1) / m_window_size;
+    }
+
+    void Spectrogram::make_linear_spectrogram(ThreadPool* thread_pool, const Filterbank* filterbank, float silence_threshold)
+    {
+        const size_t bin_count = m_fft_core->get_bin_count();
+        const size_t window_count = get_window_count();
+
+        m_bin_frequencies.clear();
+        if (filterbank)
+        {
+            release_assert(filterbank->get_window_size() == m_window_size && filterbank->get_sampling_rate() == m_sampling_rate,
+                           "filterbank was built for another window size or sampling rate")
+            // every filter becomes one row, named after its centre
+            for (float frequency : filterbank->get_centre_frequencies())
             {
-                if (frame_idx == 0)
-                {
-                    window[w_idx] = (*m_pcm)[frame_idx + w_idx];
-                    continue;
-                }
-                // 50% overlapping window
-                window[w_idx] = (*m_pcm)[frame_idx + w_idx - m_window_size / 2];
+                m_bin_frequencies.push_back(static_cast<size_t>(frequency));
             }
-            m_fft_core->process_window(std::move(window));
-            float ts = m_time_resolution * frame_idx;
+        }
+        for (size_t b_idx = 0; b_idx < bin_count && !filterbank; b_idx++)
+        {
+            float frequency = static_cast<float>(b_idx) / m_window_size * m_sampling_rate;
+            if (frequency >= m_nyquist_component)
+            {
+                break;
+            }
+            m_bin_frequencies.push_back(static_cast<size_t>(frequency));
+        }
+        m_frame_timestamps.resize(window_count);
+        for (size_t w_idx = 0; w_idx < window_count; w_idx++)
+        {
+            m_frame_timestamps[w_idx] = static_cast<size_t>(floor(m_time_resolution * get_window_position(w_idx)));
+        }
+        if (window_count > 0)
+        {
+            // centred windows of a fine hop can reach past the last legacy column
+            m_cols = std::max(m_cols, m_frame_timestamps.back() + 1);
+        }
+
+        // one flag per window, batches write disjoint ranges
+        std::vector<char> gated(silence_threshold > 0 ? window_count : 0);
+        // a fixed-point fft keeps its Q15 magnitudes as integers, floats only appear past the peaks
+        if (m_fixed_point)
+        {
+            transform_windows(thread_pool, filterbank, silence_threshold, m_fixed_magnitudes, gated);
+        }
+        else
+        {
+            transform_windows(thread_pool, filterbank, silence_threshold, m_magnitudes, gated);
+        }
+    }
+
+    template<typename T>
+    void Spectrogram::transform_windows(ThreadPool* thread_pool, const Filterbank* filterbank, float silence_threshold, std::vector<T>& magnitudes, std::vector<char>& gated)
+    {
+        const size_t bin_count = m_fft_core->get_bin_count();
+        const size_t window_count = get_frame_count();
+        const size_t batch_count = (window_count + s_batch_size - 1) / s_batch_size;
+
+        // every window owns a fixed row, so batches can be filled in any order and on any thread
+        magnitudes.resize(window_count * get_bin_count());
+
+        // a streamed pcm refills one shared buffer and has to be read in order
+        if (thread_pool && batch_count > 1 && !m_pcm->is_streaming())
+        {
+            struct Worker
+            {
+                std::unique_ptr<siren::FFT> fft;
+                std::vector<const float*> frames;
+                std::vector<T> magnitude;
+            };
+            std::vector<Worker> workers(thread_pool->get_thread_count());
 
-            for (size_t b_idx = 0; b_idx < m_fft_core->get_fft_size(); b_idx++)
+            thread_pool->parallel_for(batch_count, [&](size_t batch_idx, size_t worker_idx)
             {
-                if (static_cast<float>(b_idx) / m_window_size * m_sampling_rate >= m_nyquist_component)
+                Worker& worker = workers[worker_idx];
+                if (!worker.fft)
                 {
-                    break;
+                    worker.fft = m_fft_core->clone();
+                    worker.frames.resize(s_batch_size);
+                    worker.magnitude.resize(s_batch_size * bin_count);
                 }
-                FreqBin freq_bin(
-                    b_idx,
-                    m_window_size,
-                    m_sampling_rate,
-                    m_fft_core->get_real_by_idx(b_idx),
-                    m_fft_core->get_imag_by_idx(b_idx));
+                transform_batch(*worker.fft, filterbank, silence_threshold, batch_idx, worker.frames, worker.magnitude, magnitudes, gated);
+            });
+        }
+        else
+        {
+            std::vector<const float*> frames(s_batch_size);
+            std::vector<T> magnitude(s_batch_size * bin_count);
+            for (size_t batch_idx = 0; batch_idx < batch_count; batch_idx++)
+            {
+                transform_batch(*m_fft_core, filterbank, silence_threshold, batch_idx, frames, magnitude, magnitudes, gated);
+            }
+        }
+
+        if (std::find(gated.begin(), gated.end(), 1) != gated.end())
+        {
+            remove_gated_frames(gated, magnitudes);
+        }
+    }
+
+    template<typename T>
+    void Spectrogram::transform_batch(siren::FFT& fft, const Filterbank* filterbank, float silence_threshold, size_t batch_idx, std::vector<const float*>& frames,
+                                      std::vector<T>& magnitude, std::vector<T>& magnitudes, std::vector<char>& gated)
+    {
+        const size_t bin_count = fft.get_bin_count();
+        const size_t used_bins = get_bin_count();
+        const size_t first_window = batch_idx * s_batch_size;
+
+        size_t count = std::min(s_batch_size, get_frame_count() - first_window);
+        size_t first_start = get_window_start(first_window);
+        size_t last_start = get_window_start(first_window + count - 1);
+
+        // one request for the whole batch keeps every window valid while a streamed pcm refills,
+        // overlapping windows point into the same samples instead of copying them per window
+        const float* samples = m_pcm->get_frames(first_start, last_start + m_window_size - first_start);
+        // mean square against the squared threshold, the rms itself is never needed
+        const float min_energy = silence_threshold * silence_threshold * m_window_size;
+        size_t transformed = 0;
+        for (size_t k = 0; k < count; k++)
+        {
+            const float* window = samples + get_window_start(first_window + k) - first_start;
+            if (silence_threshold > 0 && simd::dot_product(window, window, m_window_size) < min_energy)
+            {
+                gated[first_window + k] = 1;
+                continue;
+            }
+            frames[transformed++] = window;
+        }
+        if (transformed > 0)
+        {
+            process_magnitudes(fft, frames.data(), transformed, magnitude.data());
+        }
+
+        // gated rows stay unwritten, remove_gated_frames drops them
+        const T* frame_magnitude = magnitude.data();
+        for (size_t k = 0; k < count; k++)
+        {
+            if (!gated.empty() && gated[first_window + k])
+            {
+                continue;
+            }
+            T* row = magnitudes.data() + (first_window + k) * used_bins;
+            if (filterbank)
+            {
+                filterbank->apply(frame_magnitude, row);
+            }
+            else
+            {
+                std::copy_n(frame_magnitude, used_bins, row);
+            }
+            frame_magnitude += bin_count;
+        }
+    }
 
-                triplet_list.emplace_back(Triplet(freq_bin.get_frequency(), floor(ts), freq_bin.get_magnitude()));
+    template<typename T>
+    void Spectrogram::remove_gated_frames(const std::vector<char>& gated, std::vector<T>& magnitudes)
+    {
+        const size_t used_bins = get_bin_count();
+        size_t kept = 0;
+        bool after_gap = false;
+        m_run_starts.clear();
+        for (size_t w_idx = 0; w_idx < gated.size(); w_idx++)
+        {
+            if (gated[w_idx])
+            {
+                after_gap = kept > 0;
+                continue;
+            }
+            if (after_gap)
+            {
+                m_run_starts.push_back(kept);
+                after_gap = false;
             }
+            if (kept != w_idx)
+            {
+                std::copy_n(magnitudes.data() + w_idx * used_bins, used_bins, magnitudes.data() + kept * used_bins);
+                m_frame_timestamps[kept] = m_frame_timestamps[w_idx];
+            }
+            kept++;
         }
-        m_spectrogram.setFromTriplets(triplet_list.begin(), triplet_list.end());
+        // m_cols still spans the whole range, gated stretches are simply empty columns
+        m_frame_timestamps.resize(kept);
+        magnitudes.resize(kept * used_bins);
+        magnitudes.shrink_to_fit();
     }
 
     void Spectrogram::set_sampling_rate()
@@ -100,10 +356,9 @@ namespace siren
     void Spectrogram::init_spectrogram()
     {
         size_t last_ts = m_window_counter * m_window_size * m_time_resolution;
-        size_t non_zero_est = (m_nyquist_component / m_freq_resolution) * (last_ts / m_time_resolution);
 
-        m_spectrogram = Eigen::SparseMatrix<float, Eigen::RowMajor>(ceil(m_nyquist_component), last_ts + 1);
-        m_spectrogram.reserve(non_zero_est);
+        m_rows = ceil(m_nyquist_component);
+        m_cols = last_ts + 1;
     }
 
     size_t Spectrogram::get_window_size() const
@@ -111,6 +366,11 @@ namespace siren
         return m_window_size;
     }
 
+    size_t Spectrogram::get_hop_size() const
+    {
+        return m_hop_size;
+    }
+
     unsigned int Spectrogram::get_sampling_rate() const
     {
         return m_sampling_rate;
@@ -118,20 +378,308 @@ namespace siren
 
     size_t Spectrogram::rows() const
     {
-        return m_spectrogram.rows();
+        return m_rows;
     }
 
     size_t Spectrogram::cols() const
     {
-        return m_spectrogram.cols();
+        return m_cols;
     }
 
+    const std::vector<float>& Spectrogram::get_magnitudes() const
+    {
+        return m_magnitudes;
+    }
+
+    const float* Spectrogram::get_frame(size_t frame_idx) const
+    {
+        return m_magnitudes.data() + frame_idx * get_bin_count();
+    }
+
+    const std::vector<int32_t>& Spectrogram::get_fixed_magnitudes() const
+    {
+        return m_fixed_magnitudes;
+    }
 
-    PeakSpectrogram::PeakSpectrogram(std::unique_ptr<siren::audio::PCM> pcm, std::unique_ptr<siren::FFT> fft, float zscore, size_t bands)
-        : Spectrogram(std::move(pcm), std::move(fft)), m_zscore(zscore), m_bands(bands)
+    const int32_t* Spectrogram::get_fixed_frame(size_t frame_idx) const
+    {
+        return m_fixed_magnitudes.data() + frame_idx * get_bin_count();
+    }
+
+    size_t Spectrogram::get_frame_count() const
+    {
+        return m_frame_timestamps.size();
+    }
+
+    size_t Spectrogram::get_bin_count() const
+    {
+        return m_bin_frequencies.size();
+    }
+
+    size_t Spectrogram::get_frame_timestamp(size_t frame_idx) const
+    {
+        return m_frame_timestamps[frame_idx];
+    }
+
+    std::vector<std::pair<size_t, size_t>> Spectrogram::get_frame_runs() const
+    {
+        std::vector<std::pair<size_t, size_t>> runs;
+        size_t first = 0;
+        for (size_t run_start : m_run_starts)
+        {
+            runs.emplace_back(first, run_start);
+            first = run_start;
+        }
+        if (first < m_frame_timestamps.size())
+        {
+            runs.emplace_back(first, m_frame_timestamps.size());
+        }
+        return runs;
+    }
+
+    size_t Spectrogram::get_bin_frequency(size_t bin_idx) const
+    {
+        return m_bin_frequencies[bin_idx];
+    }
+
+    const std::vector<size_t>& Spectrogram::get_bin_frequencies() const
+    {
+        return m_bin_frequencies;
+    }
+
+    size_t Spectrogram::get_memory_usage() const
+    {
+        return m_magnitudes.capacity() * sizeof(float)
+            + m_fixed_magnitudes.capacity() * sizeof(int32_t)
+            + m_frame_timestamps.capacity() * sizeof(size_t)
+            + m_run_starts.capacity() * sizeof(size_t)
+            + m_bin_frequencies.capacity() * sizeof(size_t);
+    }
+
+    Eigen::SparseMatrix<float, Eigen::RowMajor> Spectrogram::make_sparse_spectrogram() const
+    {
+        std::vector<Triplet> triplet_list;
+        triplet_list.reserve(get_frame_count() * get_bin_count());
+        for (size_t f_idx = 0; f_idx < get_frame_count(); f_idx++)
+        {
+            for (size_t b_idx = 0; b_idx < get_bin_count(); b_idx++)
+            {
+                // Q15 magnitudes become floats here, at the edge of the fixed-point pipeline
+                float value = m_fixed_point ? static_cast<float>(get_fixed_frame(f_idx)[b_idx]) / FixedPointFFT::s_one : get_frame(f_idx)[b_idx];
+                triplet_list.emplace_back(Triplet(m_bin_frequencies[b_idx], m_frame_timestamps[f_idx], value));
+            }
+        }
+
+        Eigen::SparseMatrix<float, Eigen::RowMajor> spectrogram(m_rows, m_cols);
+        spectrogram.setFromTriplets(triplet_list.begin(), triplet_list.end());
+        return spectrogram;
+    }
+
+    void Spectrogram::release_inputs()
+    {
+        m_pcm.reset();
+        m_fft_core.reset();
+    }
+
+    void Spectrogram::release_magnitudes()
+    {
+        std::vector<float>().swap(m_magnitudes);
+        std::vector<int32_t>().swap(m_fixed_magnitudes);
+    }
+
+    bool Spectrogram::has_magnitudes() const
+    {
+        return !m_magnitudes.empty() || !m_fixed_magnitudes.empty();
+    }
+
+    bool Spectrogram::write(const std::string& path, const std::string& key) const
+    {
+        if (!has_magnitudes())
+        {
+            return false;
+        }
+        return write_file(path, key, true, {});
+    }
+
+    std::unique_ptr<Spectrogram> Spectrogram::load(const std::string& path, const std::string& key)
+    {
+        std::unique_ptr<Spectrogram> spectrogram(new Spectrogram());
+        std::vector<std::pair<size_t, size_t>> peaks;
+        if (!spectrogram->read_file(path, key, peaks) || !spectrogram->has_magnitudes())
+        {
+            return nullptr;
+        }
+        return spectrogram;
+    }
+
+    bool Spectrogram::write_file(const std::string& path, const std::string& key, bool with_magnitudes, const std::vector<std::pair<size_t, size_t>>& peaks) const
+    {
+        SpectrogramFileHeader header{};
+        std::memcpy(header.magic, s_file_magic, sizeof(s_file_magic));
+        header.version = s_file_version;
+        header.flags = m_fixed_point ? s_fixed_point_flag : 0;
+        header.key_size = key.size();
+        header.sampling_rate = m_sampling_rate;
+        header.window_size = m_window_size;
+        header.hop_size = m_hop_size;
+        header.time_offset = m_time_offset;
+        header.rows = m_rows;
+        header.cols = m_cols;
+        header.frame_count = m_frame_timestamps.size();
+        header.bin_count = m_bin_frequencies.size();
+        header.magnitude_count = with_magnitudes ? m_magnitudes.size() + m_fixed_magnitudes.size() : 0;
+        header.peak_count = peaks.size();
+        header.run_count = m_run_starts.size();
+        header.time_resolution = m_time_resolution;
+        header.freq_resolution = m_freq_resolution;
+
+        std::vector<uint64_t> bin_frequencies(m_bin_frequencies.begin(), m_bin_frequencies.end());
+        std::vector<uint64_t> frame_timestamps(m_frame_timestamps.begin(), m_frame_timestamps.end());
+        std::vector<uint64_t> run_starts(m_run_starts.begin(), m_run_starts.end());
+        std::vector<uint32_t> peak_list;
+        peak_list.reserve(peaks.size() * 2);
+        for (auto [row, col] : peaks)
+        {
+            peak_list.push_back(row);
+            peak_list.push_back(col);
+        }
+
+        // written next to the target and renamed, so concurrent readers never map a partial file
+        const std::string tmp_path = path + ".tmp";
+        {
+            std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+            const char padding[8] = {};
+            auto write_section = [&](const void* data, size_t size)
+            {
+                file.write(static_cast<const char*>(data), size);
+                file.write(padding, align_section(size) - size);
+            };
+
+            write_section(&header, sizeof(header));
+            write_section(key.data(), key.size());
+            write_section(bin_frequencies.data(), bin_frequencies.size() * sizeof(uint64_t));
+            write_section(frame_timestamps.data(), frame_timestamps.size() * sizeof(uint64_t));
+            write_section(run_starts.data(), run_starts.size() * sizeof(uint64_t));
+            // float or Q15 int32 depending on the fixed-point flag, both take four bytes
+            const void* magnitudes = m_fixed_point ? (const void*)m_fixed_magnitudes.data() : (const void*)m_magnitudes.data();
+            write_section(magnitudes, header.magnitude_count * sizeof(float));
+            write_section(peak_list.data(), peak_list.size() * sizeof(uint32_t));
+            if (!file.flush())
+            {
+                file.close();
+                std::remove(tmp_path.c_str());
+                return false;
+            }
+        }
+        if (std::rename(tmp_path.c_str(), path.c_str()) != 0)
+        {
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool Spectrogram::read_file(const std::string& path, const std::string& key, std::vector<std::pair<size_t, size_t>>& peaks)
+    {
+        siren::audio::MappedFile file(path);
+        if (!file.map() || file.get_size() < sizeof(SpectrogramFileHeader))
+        {
+            return false;
+        }
+
+        const char* data = static_cast<const char*>(file.get_data());
+        SpectrogramFileHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, s_file_magic, sizeof(s_file_magic)) != 0 || header.version != s_file_version)
+        {
+            return false;
+        }
+        // bounds the counts before they are multiplied into offsets
+        const size_t file_size = file.get_size();
+        if (header.key_size > file_size || header.bin_count > file_size || header.frame_count > file_size || header.peak_count > file_size
+            || header.run_count > file_size)
+        {
+            return false;
+        }
+        if (header.magnitude_count != 0 && header.magnitude_count != header.frame_count * header.bin_count)
+        {
+            return false;
+        }
+
+        const size_t key_offset = align_section(sizeof(header));
+        const size_t bins_offset = key_offset + align_section(header.key_size);
+        const size_t frames_offset = bins_offset + align_section(header.bin_count * sizeof(uint64_t));
+        const size_t runs_offset = frames_offset + align_section(header.frame_count * sizeof(uint64_t));
+        const size_t magnitudes_offset = runs_offset + align_section(header.run_count * sizeof(uint64_t));
+        const size_t peaks_offset = magnitudes_offset + align_section(header.magnitude_count * sizeof(float));
+        const size_t file_end = peaks_offset + align_section(header.peak_count * 2 * sizeof(uint32_t));
+        if (file_end != file_size || key != std::string_view(data + key_offset, header.key_size))
+        {
+            return false;
+        }
+
+        m_fixed_point = header.flags & s_fixed_point_flag;
+        m_sampling_rate = header.sampling_rate;
+        m_window_size = header.window_size;
+        m_hop_size = header.hop_size;
+        m_time_offset = header.time_offset;
+        m_rows = header.rows;
+        m_cols = header.cols;
+        m_time_resolution = header.time_resolution;
+        m_freq_resolution = header.freq_resolution;
+        m_nyquist_component = m_sampling_rate / 2;
+
+        const auto* bin_frequencies = reinterpret_cast<const uint64_t*>(data + bins_offset);
+        const auto* frame_timestamps = reinterpret_cast<const uint64_t*>(data + frames_offset);
+        const auto* run_starts = reinterpret_cast<const uint64_t*>(data + runs_offset);
+        const auto* magnitudes = reinterpret_cast<const float*>(data + magnitudes_offset);
+        const auto* peak_list = reinterpret_cast<const uint32_t*>(data + peaks_offset);
+
+        m_bin_frequencies.assign(bin_frequencies, bin_frequencies + header.bin_count);
+        m_frame_timestamps.assign(frame_timestamps, frame_timestamps + header.frame_count);
+        m_run_starts.assign(run_starts, run_starts + header.run_count);
+        for (size_t r_idx = 0; r_idx < m_run_starts.size(); r_idx++)
+        {
+            if (m_run_starts[r_idx] == 0 || m_run_starts[r_idx] >= m_frame_timestamps.size() || (r_idx > 0 && m_run_starts[r_idx] <= m_run_starts[r_idx - 1]))
+            {
+                return false;
+            }
+        }
+        if (m_fixed_point)
+        {
+            const auto* fixed_magnitudes = reinterpret_cast<const int32_t*>(data + magnitudes_offset);
+            m_fixed_magnitudes.assign(fixed_magnitudes, fixed_magnitudes + header.magnitude_count);
+        }
+        else
+        {
+            m_magnitudes.assign(magnitudes, magnitudes + header.magnitude_count);
+        }
+        peaks.resize(header.peak_count);
+        for (size_t p_idx = 0; p_idx < peaks.size(); p_idx++)
+        {
+            peaks[p_idx] = {peak_list[2 * p_idx], peak_list[2 * p_idx + 1]};
+            if (peaks[p_idx].first >= m_rows || peaks[p_idx].second >= m_cols)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    PeakSpectrogram::PeakSpectrogram(std::unique_ptr<siren::audio::PCM> pcm, std::unique_ptr<siren::FFT> fft, float zscore, size_t bands, StatsEngine engine,
+                                     PeakDetector detector, PeakNeighborhood neighborhood, ThreadPool* thread_pool)
+        : Spectrogram(std::move(pcm), std::move(fft), thread_pool), m_zscore(zscore), m_bands(bands), m_stats_engine(engine), m_detector(detector), m_neighborhood(neighborhood)
     {
         init_peak_spectrogram();
-        make_peak_spectrogram();
+        make_peak_spectrogram(thread_pool);
+    }
+
+    PeakSpectrogram::PeakSpectrogram(Spectrogram&& spectrogram, float zscore, size_t bands, StatsEngine engine,
+                                     PeakDetector detector, PeakNeighborhood neighborhood, ThreadPool* thread_pool)
+        : Spectrogram(std::move(spectrogram)), m_zscore(zscore), m_bands(bands), m_stats_engine(engine), m_detector(detector), m_neighborhood(neighborhood)
+    {
+        init_peak_spectrogram();
+        make_peak_spectrogram(thread_pool);
     }
 
     void PeakSpectrogram::init_peak_spectrogram()
@@ -144,80 +692,153 @@ namespace siren
         return m_peak_spectrogram;
     }
 
-    std::vector<std::pair<size_t, size_t>> PeakSpectrogram::get_occupied_indices()
+    bool PeakSpectrogram::write(const std::string& path, const std::string& key) const
     {
-        std::vector<std::pair<size_t, size_t>> indices;
-        for (size_t i = 0; i < m_peak_spectrogram.outerSize(); i++)
+        std::vector<std::pair<size_t, size_t>> peaks;
+        peaks.reserve(m_peak_spectrogram.nonZeros());
+        for (Eigen::Index i = 0; i < m_peak_spectrogram.outerSize(); i++)
         {
             for (Eigen::SparseMatrix<float, Eigen::RowMajor>::InnerIterator it(m_peak_spectrogram, i); it; ++it)
             {
-                indices.emplace_back(it.row(), it.col());
+                peaks.emplace_back(it.row(), it.col());
             }
         }
-        return indices;
+        return write_file(path, key, false, peaks);
     }
 
-    void PeakSpectrogram::make_peak_spectrogram()
+    std::unique_ptr<PeakSpectrogram> PeakSpectrogram::load(const std::string& path, const std::string& key)
     {
+        std::unique_ptr<PeakSpectrogram> spectrogram(new PeakSpectrogram());
+        std::vector<std::pair<size_t, size_t>> peaks;
+        if (!spectrogram->read_file(path, key, peaks))
+        {
+            return nullptr;
+        }
+
         std::vector<Triplet> triplet_list;
-        auto distribution = log_distribution(this->rows(), m_bands);
+        triplet_list.reserve(peaks.size());
+        for (auto [row, col] : peaks)
+        {
+            triplet_list.emplace_back(Triplet(row, col, 255.0f));
+        }
+        spectrogram->init_peak_spectrogram();
+        spectrogram->m_peak_spectrogram.setFromTriplets(triplet_list.begin(), triplet_list.end());
+        return spectrogram;
+    }
 
-        auto flattenEigenBlock = [](const Eigen::SparseMatrix<float, Eigen::RowMajor>& block, auto& vec)
+    std::vector<std::pair<size_t, size_t>> PeakSpectrogram::get_occupied_indices()
+    {
+        std::vector<std::pair<size_t, size_t>> indices;
+        for (Eigen::Index i = 0; i < m_peak_spectrogram.outerSize(); i++)
         {
-            for (size_t i = 0; i < block.outerSize(); i++)
+            for (Eigen::SparseMatrix<float, Eigen::RowMajor>::InnerIterator it(m_peak_spectrogram, i); it; ++it)
             {
-                for (Eigen::SparseMatrix<float, Eigen::RowMajor>::InnerIterator it(block, i); it; ++it)
-                {
-                    vec.emplace_back(it.value());
-                }
+                indices.emplace_back(it.row(), it.col());
             }
-        };
+        }
+        return indices;
+    }
 
-        auto spec = this->get_spectrogram_view();
-        for (int i = 0; i < distribution.size() - 1; i++)
+    void PeakSpectrogram::make_peak_spectrogram(ThreadPool* thread_pool)
+    {
+        if (this->is_fixed_point())
         {
-            int row_range = distribution[i + 1] - distribution[i];
-
-            Eigen::SparseMatrix<float, Eigen::RowMajor> block = spec.block(distribution[i], 0, row_range, spec.cols());
-            block.prune([](size_t, size_t, float val) {
-                return val >= 0.0;
-            });
+            make_peak_spectrogram(this->get_fixed_magnitudes(), thread_pool);
+        }
+        else
+        {
+            make_peak_spectrogram(this->get_magnitudes(), thread_pool);
+        }
+    }
 
-            std::vector<float> flat_block;
-            flattenEigenBlock(block, flat_block);
+    template<typename T>
+    void PeakSpectrogram::make_peak_spectrogram(const std::vector<T>& magnitudes, ThreadPool* thread_pool)
+    {
+        std::vector<T> neighborhood_max;
+        if (m_detector == PeakDetector::LocalMaximum)
+        {
+            // frames on either side of a gated stretch are not neighbours, each run is filtered on its own
+            const size_t bin_count = this->get_bin_count();
+            neighborhood_max.resize(magnitudes.size());
+            for (auto [first, last] : this->get_frame_runs())
+            {
+                MaxFilter2D().apply(magnitudes.data() + first * bin_count, last - first, bin_count,
+                                    m_neighborhood.frames, m_neighborhood.bins, neighborhood_max.data() + first * bin_count);
+            }
+        }
 
-            double median = get_median(flat_block);
-            double mad = get_mad(flat_block, median);
+        auto bands = log_band_ranges(this->get_bin_frequencies(), this->rows(), m_bands);
 
-            block.prune([this, median, mad](size_t, size_t, float val) {
-                return get_zscore_of_peak(median, mad, val) >= m_zscore;
-            });
+        // bands share nothing, each one fills its own list and the lists are joined in band order
+        std::vector<std::vector<Triplet>> band_triplets(bands.size());
+        if (thread_pool && bands.size() > 1)
+        {
+            struct Worker
+            {
+                std::unique_ptr<BandThreshold> threshold;
+                std::vector<T> flat_block;
+            };
+            std::vector<Worker> workers(thread_pool->get_thread_count());
 
-            for (size_t j = 0; j < block.outerSize(); j++)
+            thread_pool->parallel_for(bands.size(), [&](size_t band_idx, size_t worker_idx)
             {
-                for (auto it = Eigen::SparseMatrix<float, Eigen::RowMajor>::InnerIterator(block, j); it; ++it)
+                Worker& worker = workers[worker_idx];
+                if (!worker.threshold)
                 {
-                    int freq = distribution[i] + it.row();
-                    size_t ts = it.col();
-                    triplet_list.emplace_back(Triplet(freq, ts, 255.0f));
+                    worker.threshold = std::make_unique<BandThreshold>(m_zscore, m_stats_engine);
                 }
+                select_band_peaks(bands[band_idx], magnitudes, *worker.threshold, worker.flat_block, neighborhood_max, band_triplets[band_idx]);
+            });
+        }
+        else
+        {
+            BandThreshold threshold(m_zscore, m_stats_engine);
+            std::vector<T> flat_block;
+            for (size_t band_idx = 0; band_idx < bands.size(); band_idx++)
+            {
+                select_band_peaks(bands[band_idx], magnitudes, threshold, flat_block, neighborhood_max, band_triplets[band_idx]);
             }
         }
 
+        std::vector<Triplet> triplet_list;
+        for (const auto& triplets : band_triplets)
+        {
+            triplet_list.insert(triplet_list.end(), triplets.begin(), triplets.end());
+        }
         m_peak_spectrogram.setFromTriplets(triplet_list.begin(), triplet_list.end());
     }
 
-    std::vector<unsigned int> PeakSpectrogram::log_distribution(size_t end_index, size_t bands)
+    template<typename T>
+    void PeakSpectrogram::select_band_peaks(std::pair<size_t, size_t> band, const std::vector<T>& magnitudes, BandThreshold& threshold, std::vector<T>& flat_block,
+                                            const std::vector<T>& neighborhood_max, std::vector<Triplet>& triplets) const
     {
-        double scale = end_index / log(1.0 + bands);
-        std::vector<unsigned int> intervals;
-        for (int i = bands - 1; i >= 0; i--)
+        auto [band_start, band_end] = band;
+        const size_t bin_count = this->get_bin_count();
+        auto is_local_maximum = [&](size_t f_idx, size_t b_idx, T val)
+        {
+            // silent plateaus are maxima of themselves, they are no peaks
+            return neighborhood_max.empty() || (val > 0 && val == neighborhood_max[f_idx * bin_count + b_idx]);
+        };
+
+        flat_block.clear();
+        for (size_t f_idx = 0; f_idx < this->get_frame_count(); f_idx++)
+        {
+            const T* frame = magnitudes.data() + f_idx * bin_count;
+            flat_block.insert(flat_block.end(), frame + band_start, frame + band_end);
+        }
+        threshold.fit(flat_block);
+
+        for (size_t f_idx = 0; f_idx < this->get_frame_count(); f_idx++)
         {
-            int upper_bound = log(2.0 + i) * scale;
-            intervals.push_back(end_index - upper_bound);
+            const T* frame = magnitudes.data() + f_idx * bin_count;
+            for (size_t b_idx = band_start; b_idx < band_end; b_idx++)
+            {
+                if (threshold.is_peak(frame[b_idx]) && is_local_maximum(f_idx, b_idx, frame[b_idx]))
+                {
+                    triplets.emplace_back(Triplet(this->get_bin_frequency(b_idx), this->get_frame_timestamp(f_idx), 255.0f));
+                }
+            }
         }
-        intervals.push_back(end_index);
-        return intervals;
     }
 
-}// namespace siren
\ No newline at end of file
+}// namespace siren
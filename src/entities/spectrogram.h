@@ -1,15 +1,22 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include <vector>
 #include <type_traits>
+#include <utility>
 
 #include <Eigen/Core>
 #include <Eigen/Sparse>
 
 #include "../decoder/pcm.h"
 #include "../fft/fft.h"
+#include "../fft/fixed_fft.h"
+#include "../fft/filterbank.h"
+#include "../common/thread_pool.h"
 #include "freq_bin.h"
+#include "band_stats.h"
+#include "max_filter.h"
 
 namespace siren
 {
@@ -19,26 +26,106 @@ namespace siren
     {
 
     public:
-        Spectrogram(std::unique_ptr<siren::audio::PCM> pcm, std::unique_ptr<siren::FFT> fft);
+        /**
+        * hop_size 0 keeps the legacy framing, windows with an rms below silence_threshold leave no frame
+        */
+        Spectrogram(std::unique_ptr<siren::audio::PCM> pcm, std::unique_ptr<siren::FFT> fft, ThreadPool* thread_pool = nullptr, size_t hop_size = 0,
+                    const Filterbank* filterbank = nullptr, float silence_threshold = 0);
 
         [[nodiscard]] size_t get_window_size() const;
 
+        [[nodiscard]] size_t get_hop_size() const;
+
         [[nodiscard]] unsigned int get_sampling_rate() const;
 
         [[nodiscard]] float get_time_resolution() const;
 
+        [[nodiscard]] size_t get_time_offset() const;
+
+        [[nodiscard]] bool is_fixed_point() const;
+
         [[nodiscard]] float get_freq_resolution() const;
 
         [[nodiscard]] size_t rows() const;
 
         [[nodiscard]] size_t cols() const;
 
-        [[nodiscard]] const Eigen::SparseMatrix<float, Eigen::RowMajor>& get_spectrogram_view() const;
+        /**
+        * frame after frame, get_bin_count() values each, empty for a fixed-point spectrogram
+        */
+        [[nodiscard]] const std::vector<float>& get_magnitudes() const;
+
+        [[nodiscard]] const float* get_frame(size_t frame_idx) const;
+
+        [[nodiscard]] const std::vector<int32_t>& get_fixed_magnitudes() const;
+
+        [[nodiscard]] const int32_t* get_fixed_frame(size_t frame_idx) const;
+
+        [[nodiscard]] size_t get_frame_count() const;
+
+        [[nodiscard]] size_t get_bin_count() const;
+
+        [[nodiscard]] size_t get_frame_timestamp(size_t frame_idx) const;
+
+        /**
+        * [first, last) frames with no gated window between them, neighbourhoods must not cross two runs
+        */
+        [[nodiscard]] std::vector<std::pair<size_t, size_t>> get_frame_runs() const;
+
+        [[nodiscard]] size_t get_bin_frequency(size_t bin_idx) const;
+
+        [[nodiscard]] const std::vector<size_t>& get_bin_frequencies() const;
+
+        [[nodiscard]] size_t get_memory_usage() const;
+
+        [[nodiscard]] Eigen::SparseMatrix<float, Eigen::RowMajor> make_sparse_spectrogram() const;
+
+        void release_inputs();
+
+        /**
+        * get_frame and get_magnitudes must not be used afterwards
+        */
+        void release_magnitudes();
+
+        [[nodiscard]] bool has_magnitudes() const;
+
+        /**
+        * key names the source and stft parameters, load rejects a file written under another key
+        */
+        bool write(const std::string& path, const std::string& key) const;
+
+        /**
+        * nullptr when the file is missing, malformed or keyed differently, the result has no pcm or fft
+        */
+        static std::unique_ptr<Spectrogram> load(const std::string& path, const std::string& key);
+
+    protected:
+        Spectrogram();
+
+        bool write_file(const std::string& path, const std::string& key, bool with_magnitudes, const std::vector<std::pair<size_t, size_t>>& peaks) const;
+
+        bool read_file(const std::string& path, const std::string& key, std::vector<std::pair<size_t, size_t>>& peaks);
 
     private:
         void init_spectrogram();
 
-        void make_linear_spectrogram();
+        void make_linear_spectrogram(ThreadPool* thread_pool, const Filterbank* filterbank, float silence_threshold);
+
+        template<typename T>
+        void transform_windows(ThreadPool* thread_pool, const Filterbank* filterbank, float silence_threshold, std::vector<T>& magnitudes, std::vector<char>& gated);
+
+        template<typename T>
+        void transform_batch(siren::FFT& fft, const Filterbank* filterbank, float silence_threshold, size_t batch_idx, std::vector<const float*>& frames,
+                             std::vector<T>& magnitude, std::vector<T>& magnitudes, std::vector<char>& gated);
+
+        template<typename T>
+        void remove_gated_frames(const std::vector<char>& gated, std::vector<T>& magnitudes);
+
+        [[nodiscard]] size_t get_window_start(size_t window_idx) const;
+
+        [[nodiscard]] size_t get_window_position(size_t window_idx) const;
+
+        [[nodiscard]] size_t get_window_count() const;
 
         void set_sampling_rate();
 
@@ -51,75 +138,80 @@ namespace siren
         void set_freq_resolution();
 
     private:
+        static constexpr size_t s_batch_size = 64; // windows handed to the fft per call
+
         std::unique_ptr<siren::audio::PCM> m_pcm;
         std::unique_ptr<siren::FFT> m_fft_core;
-        Eigen::SparseMatrix<float, Eigen::RowMajor> m_spectrogram;
+        std::vector<float> m_magnitudes;
+        std::vector<int32_t> m_fixed_magnitudes;
+        std::vector<size_t> m_frame_timestamps;
+        std::vector<size_t> m_run_starts; // frames that directly follow dropped windows
+        std::vector<size_t> m_bin_frequencies;
+        size_t m_rows;
+        size_t m_cols;
         unsigned int m_sampling_rate;
         size_t m_window_size;
+        size_t m_hop_size;
         size_t m_window_counter;
         float m_time_resolution;
         float m_freq_resolution;
         float m_nyquist_component;
+        size_t m_time_offset;
+        bool m_fixed_point;
+    };
+
+    /**
+    * LocalMaximum additionally requires a peak to dominate its PeakNeighborhood
+    */
+    enum class PeakDetector
+    {
+        ZScore,
+        LocalMaximum
+    };
+
+    struct PeakNeighborhood
+    {
+        size_t frames = 1;
+        size_t bins = 3;
     };
 
     class PeakSpectrogram : public Spectrogram
     {
     public:
-        PeakSpectrogram(std::unique_ptr<siren::audio::PCM> pcm, std::unique_ptr<siren::FFT> fft, float zscore = 3, size_t bands=15);
+        PeakSpectrogram(std::unique_ptr<siren::audio::PCM> pcm, std::unique_ptr<siren::FFT> fft, float zscore = 3, size_t bands=15, StatsEngine engine = StatsEngine::Select,
+                        PeakDetector detector = PeakDetector::ZScore, PeakNeighborhood neighborhood = {}, ThreadPool* thread_pool = nullptr);
+
+        PeakSpectrogram(Spectrogram&& spectrogram, float zscore = 3, size_t bands=15, StatsEngine engine = StatsEngine::Select,
+                        PeakDetector detector = PeakDetector::ZScore, PeakNeighborhood neighborhood = {}, ThreadPool* thread_pool = nullptr);
         [[nodiscard]] std::vector<std::pair<size_t, size_t>> get_occupied_indices();
         [[nodiscard]] const Eigen::SparseMatrix<float, Eigen::RowMajor>& get_peak_spec_view() const;
 
+        /**
+        * key should name the peak parameters on top of the spectrogram ones
+        */
+        bool write(const std::string& path, const std::string& key) const;
+
+        static std::unique_ptr<PeakSpectrogram> load(const std::string& path, const std::string& key);
+
     private:
-        void init_peak_spectrogram();
-        void make_peak_spectrogram();
-        std::vector<unsigned int> log_distribution(size_t end_index, size_t bands);
+        PeakSpectrogram() = default;
 
-        template<typename T>
-        double get_median(std::vector<T> dist)
-        {
-            if (dist.empty())
-            {
-                return 0;
-            }
-            std::sort(dist.begin(), dist.end());
-            return dist[dist.size()/2];
-        }
+        void init_peak_spectrogram();
+        void make_peak_spectrogram(ThreadPool* thread_pool);
 
         template<typename T>
-        double get_mad(std::vector<T> dist, double median)
-        {
-            if (dist.empty())
-            {
-                return 0;
-            }
-
-            size_t size = dist.size();
-
-            std::vector<double> deviations(size);
-            std::transform(dist.begin(), dist.end(), deviations.begin(),
-            [&](T x)
-            {
-                return std::abs(x - median);
-            });
-
-            std::sort(deviations.begin(), deviations.end());
-            return deviations[size/2];
-        }
+        void make_peak_spectrogram(const std::vector<T>& magnitudes, ThreadPool* thread_pool);
 
         template<typename T>
-        double get_zscore_of_peak(double median, double mad, T point)
-        {
-            double z_score = 0.6745 * ((point - median) / mad);
-            if (isnan(z_score) || isinf(z_score))
-            {
-                z_score = 0;
-            }
-            return z_score;
-        }
+        void select_band_peaks(std::pair<size_t, size_t> band, const std::vector<T>& magnitudes, BandThreshold& threshold, std::vector<T>& flat_block,
+                               const std::vector<T>& neighborhood_max, std::vector<Triplet>& triplets) const;
 
     private:
-        float m_zscore;
-        size_t m_bands;
+        float m_zscore{0};
+        size_t m_bands{0};
+        StatsEngine m_stats_engine{StatsEngine::Select};
+        PeakDetector m_detector{PeakDetector::ZScore};
+        PeakNeighborhood m_neighborhood;
         Eigen::SparseMatrix<float, Eigen::RowMajor> m_peak_spectrogram;
     };
 
@@ -0,0 +1,220 @@
+#include "streaming_spectrogram.h"
+#include "../common/common.h"
+
+namespace siren
+{
+
+    StreamingPeakSpectrogram::StreamingPeakSpectrogram(std::unique_ptr<siren::FFT> fft, unsigned int sampling_rate, size_t hop_size, float zscore, size_t bands,
+                                                       size_t horizon_frames, size_t segment_frames, StatsEngine engine)
+        : m_fft_core(std::move(fft)),
+          m_sampling_rate(sampling_rate),
+          m_window_size(m_fft_core->get_window_size()),
+          m_hop_size(hop_size ? hop_size : m_window_size / 2),
+          m_horizon_frames(horizon_frames),
+          m_segment_frames(segment_frames)
+    {
+        release_assert(m_hop_size > 0, "hop_size must be positive")
+        release_assert(segment_frames > 0 && segment_frames <= horizon_frames, "segment_frames must be in [1, horizon_frames]")
+
+        const size_t nyquist = m_sampling_rate / 2;
+        for (size_t b_idx = 0; b_idx < m_fft_core->get_bin_count(); b_idx++)
+        {
+            float frequency = static_cast<float>(b_idx) / m_window_size * m_sampling_rate;
+            if (frequency >= nyquist)
+            {
+                break;
+            }
+            m_bin_frequencies.push_back(static_cast<size_t>(frequency));
+        }
+        m_bands = log_band_ranges(m_bin_frequencies, nyquist, bands);
+        m_thresholds.assign(m_bands.size(), BandThreshold(zscore, engine));
+
+        size_t widest_band = 0;
+        for (auto [band_start, band_end] : m_bands)
+        {
+            widest_band = std::max(widest_band, band_end - band_start);
+        }
+        m_frames.resize(s_batch_size);
+        // a fixed-point fft keeps its Q15 magnitudes as integers all the way to the thresholds
+        if (m_fft_core->is_fixed_point())
+        {
+            m_fixed_history.resize(m_horizon_frames * get_bin_count());
+            m_fixed_magnitude.resize(s_batch_size * m_fft_core->get_bin_count());
+            m_fixed_flat_band.reserve(m_horizon_frames * widest_band);
+        }
+        else
+        {
+            m_history.resize(m_horizon_frames * get_bin_count());
+            m_magnitude.resize(s_batch_size * m_fft_core->get_bin_count());
+            m_flat_band.reserve(m_horizon_frames * widest_band);
+        }
+    }
+
+    size_t StreamingPeakSpectrogram::push(const float* samples, size_t count, std::vector<StreamPeak>& peaks)
+    {
+        // less than a window is left over between pushes, so equally sized pushes never grow the buffer again
+        m_pending.reserve(m_window_size + count);
+        m_pending.insert(m_pending.end(), samples, samples + count);
+
+        const size_t bin_count = m_fft_core->get_bin_count();
+        size_t added = 0;
+        while (true)
+        {
+            // windows point straight into the pending samples, overlaps are never copied
+            size_t ready = 0;
+            while (ready < s_batch_size)
+            {
+                size_t start = (m_frame_count + ready) * m_hop_size;
+                if (start < m_pending_offset || start - m_pending_offset + m_window_size > m_pending.size())
+                {
+                    break;
+                }
+                m_frames[ready++] = m_pending.data() + (start - m_pending_offset);
+            }
+            if (ready == 0)
+            {
+                break;
+            }
+
+            const bool fixed_point = m_fft_core->is_fixed_point();
+            if (fixed_point)
+            {
+                m_fft_core->process_magnitudes_fixed(m_frames.data(), ready, m_fixed_magnitude.data());
+            }
+            else
+            {
+                m_fft_core->process_magnitudes(m_frames.data(), ready, m_magnitude.data());
+            }
+            for (size_t k = 0; k < ready; k++)
+            {
+                if (fixed_point)
+                {
+                    add_frame(m_fixed_magnitude.data() + k * bin_count, m_fixed_history);
+                }
+                else
+                {
+                    add_frame(m_magnitude.data() + k * bin_count, m_history);
+                }
+                if (m_undecided == m_segment_frames)
+                {
+                    added += decide_frames(peaks);
+                }
+            }
+        }
+
+        // drop everything in front of the next window, when hop_size exceeds the window the gap is skipped on a later push
+        size_t next_start = m_frame_count * m_hop_size;
+        size_t consumed = std::min(next_start - m_pending_offset, m_pending.size());
+        m_pending.erase(m_pending.begin(), m_pending.begin() + consumed);
+        m_pending_offset += consumed;
+        return added;
+    }
+
+    size_t StreamingPeakSpectrogram::flush(std::vector<StreamPeak>& peaks)
+    {
+        return m_undecided ? decide_frames(peaks) : 0;
+    }
+
+    template<typename T>
+    void StreamingPeakSpectrogram::add_frame(const T* magnitude, std::vector<T>& history)
+    {
+        T* slot = history.data() + (m_frame_count % m_horizon_frames) * get_bin_count();
+        std::copy_n(magnitude, get_bin_count(), slot);
+        m_frame_count++;
+        m_undecided++;
+    }
+
+    size_t StreamingPeakSpectrogram::decide_frames(std::vector<StreamPeak>& peaks)
+    {
+        if (m_fft_core->is_fixed_point())
+        {
+            return decide_frames(m_fixed_history, m_fixed_flat_band, peaks);
+        }
+        return decide_frames(m_history, m_flat_band, peaks);
+    }
+
+    template<typename T>
+    size_t StreamingPeakSpectrogram::decide_frames(const std::vector<T>& history, std::vector<T>& flat_band, std::vector<StreamPeak>& peaks)
+    {
+        const size_t bin_count = get_bin_count();
+        const size_t horizon = std::min(m_frame_count, m_horizon_frames);
+
+        // the ring holds exactly the horizon, its order does not matter to median and mad
+        for (size_t band_idx = 0; band_idx < m_bands.size(); band_idx++)
+        {
+            auto [band_start, band_end] = m_bands[band_idx];
+            flat_band.clear();
+            for (size_t slot = 0; slot < horizon; slot++)
+            {
+                const T* frame = history.data() + slot * bin_count;
+                flat_band.insert(flat_band.end(), frame + band_start, frame + band_end);
+            }
+            m_thresholds[band_idx].fit(flat_band);
+        }
+
+        size_t added = 0;
+        for (size_t f_idx = m_frame_count - m_undecided; f_idx < m_frame_count; f_idx++)
+        {
+            const T* frame = history.data() + (f_idx % m_horizon_frames) * bin_count;
+            for (size_t band_idx = 0; band_idx < m_bands.size(); band_idx++)
+            {
+                for (size_t b_idx = m_bands[band_idx].first; b_idx < m_bands[band_idx].second; b_idx++)
+                {
+                    if (m_thresholds[band_idx].is_peak(frame[b_idx]))
+                    {
+                        peaks.push_back({m_bin_frequencies[b_idx], get_frame_timestamp(f_idx)});
+                        added++;
+                    }
+                }
+            }
+        }
+        m_undecided = 0;
+        return added;
+    }
+
+    size_t StreamingPeakSpectrogram::get_frame_timestamp(size_t frame_idx) const
+    {
+        // integer ms keep a day-long stream exact, a float sample position would not
+        uint64_t position = (uint64_t)frame_idx * m_hop_size + m_window_size / 2;
+        return position * 1000 / m_sampling_rate;
+    }
+
+    size_t StreamingPeakSpectrogram::get_window_size() const
+    {
+        return m_window_size;
+    }
+
+    size_t StreamingPeakSpectrogram::get_hop_size() const
+    {
+        return m_hop_size;
+    }
+
+    size_t StreamingPeakSpectrogram::get_bin_count() const
+    {
+        return m_bin_frequencies.size();
+    }
+
+    size_t StreamingPeakSpectrogram::get_frame_count() const
+    {
+        return m_frame_count;
+    }
+
+    size_t StreamingPeakSpectrogram::get_latency_in_ms() const
+    {
+        return (uint64_t)m_segment_frames * m_hop_size * 1000 / m_sampling_rate;
+    }
+
+    size_t StreamingPeakSpectrogram::get_memory_usage() const
+    {
+        return m_pending.capacity() * sizeof(float)
+            + m_history.capacity() * sizeof(float)
+            + m_magnitude.capacity() * sizeof(float)
+            + m_flat_band.capacity() * sizeof(float)
+            + m_fixed_history.capacity() * sizeof(int32_t)
+            + m_fixed_magnitude.capacity() * sizeof(int32_t)
+            + m_fixed_flat_band.capacity() * sizeof(int32_t)
+            + m_frames.capacity() * sizeof(const float*)
+            + m_bin_frequencies.capacity() * sizeof(size_t);
+    }
+
+}// namespace siren
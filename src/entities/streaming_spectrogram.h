@@ -0,0 +1,88 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "../fft/fft.h"
+#include "band_stats.h"
+
+namespace siren
+{
+
+    struct StreamPeak
+    {
+        size_t frequency; // Hz, truncated like a PeakSpectrogram row
+        size_t timestamp; // ms since the first pushed sample, at the centre of the window
+    };
+
+    /**
+    * push-based PeakSpectrogram, band stats cover the last horizon_frames frames and peaks are decided
+    * segment_frames at a time, memory stays fixed however long the stream runs
+    */
+    class StreamingPeakSpectrogram
+    {
+    public:
+        StreamingPeakSpectrogram(std::unique_ptr<siren::FFT> fft, unsigned int sampling_rate, size_t hop_size = 0, float zscore = 3, size_t bands = 15,
+                                 size_t horizon_frames = 512, size_t segment_frames = 32, StatsEngine engine = StatsEngine::Select);
+
+        /**
+        * returns how many peaks were appended
+        */
+        size_t push(const float* samples, size_t count, std::vector<StreamPeak>& peaks);
+
+        /**
+        * decides the frames short of a full segment, pushing can continue afterwards
+        */
+        size_t flush(std::vector<StreamPeak>& peaks);
+
+        [[nodiscard]] size_t get_window_size() const;
+
+        [[nodiscard]] size_t get_hop_size() const;
+
+        [[nodiscard]] size_t get_bin_count() const;
+
+        [[nodiscard]] size_t get_frame_count() const;
+
+        [[nodiscard]] size_t get_latency_in_ms() const;
+
+        [[nodiscard]] size_t get_memory_usage() const;
+
+    private:
+        template<typename T>
+        void add_frame(const T* magnitude, std::vector<T>& history);
+
+        size_t decide_frames(std::vector<StreamPeak>& peaks);
+
+        template<typename T>
+        size_t decide_frames(const std::vector<T>& history, std::vector<T>& flat_band, std::vector<StreamPeak>& peaks);
+
+        [[nodiscard]] size_t get_frame_timestamp(size_t frame_idx) const;
+
+    private:
+        static constexpr size_t s_batch_size = 64; // windows handed to the fft per call
+
+        std::unique_ptr<siren::FFT> m_fft_core;
+        unsigned int m_sampling_rate;
+        size_t m_window_size;
+        size_t m_hop_size;
+        size_t m_horizon_frames;
+        size_t m_segment_frames;
+        std::vector<size_t> m_bin_frequencies;
+        std::vector<std::pair<size_t, size_t>> m_bands;
+        std::vector<BandThreshold> m_thresholds;
+
+        std::vector<float> m_pending;  // samples from m_pending_offset on that are not behind the next window yet
+        size_t m_pending_offset{0};
+        std::vector<float> m_history;  // ring of the last m_horizon_frames frames, get_bin_count() floats each
+        size_t m_frame_count{0};
+        size_t m_undecided{0};
+
+        std::vector<const float*> m_frames;
+        std::vector<float> m_magnitude;
+        std::vector<float> m_flat_band;
+        std::vector<int32_t> m_fixed_history; // m_history, m_magnitude and m_flat_band in Q15 for a fixed-point fft
+        std::vector<int32_t> m_fixed_magnitude;
+        std::vector<int32_t> m_fixed_flat_band;
+    };
+
+}// namespace siren
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include "batch_fft.h"
+#include "plan_cache.h"
+#include "../common/simd.h"
+
+#ifdef SIREN_SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace siren
+{
+    namespace
+    {
+        constexpr size_t s_lanes = BatchFFT::s_lanes;
+
+        // every array element is a group of s_lanes floats, one per frame
+        void butterflies_scalar(float* re, float* im, const float* twiddle_r, const float* twiddle_i, size_t size)
+        {
+            for (size_t half = 1; half < size; half <<= 1)
+            {
+                const size_t step = size / (half * 2);
+                for (size_t i = 0; i < size; i += half * 2)
+                {
+                    for (size_t j = 0; j < half; j++)
+                    {
+                        const float wr = twiddle_r[j * step];
+                        const float wi = twiddle_i[j * step];
+                        float* ar = re + (i + j) * s_lanes;
+                        float* ai = im + (i + j) * s_lanes;
+                        float* br = re + (i + j + half) * s_lanes;
+                        float* bi = im + (i + j + half) * s_lanes;
+                        for (size_t k = 0; k < s_lanes; k++)
+                        {
+                            float tr = br[k] * wr - bi[k] * wi;
+                            float ti = br[k] * wi + bi[k] * wr;
+                            br[k] = ar[k] - tr;
+                            bi[k] = ai[k] - ti;
+                            ar[k] += tr;
+                            ai[k] += ti;
+                        }
+                    }
+                }
+            }
+        }
+
+#ifdef SIREN_SIMD_X86
+        __attribute__((target("sse2"))) void butterflies_sse2(float* re, float* im, const float* twiddle_r, const float* twiddle_i, size_t size)
+        {
+            for (size_t half = 1; half < size; half <<= 1)
+            {
+                const size_t step = size / (half * 2);
+                for (size_t i = 0; i < size; i += half * 2)
+                {
+                    for (size_t j = 0; j < half; j++)
+                    {
+                        const __m128 wr = _mm_set1_ps(twiddle_r[j * step]);
+                        const __m128 wi = _mm_set1_ps(twiddle_i[j * step]);
+                        for (size_t k = 0; k < s_lanes; k += 4)
+                        {
+                            float* ar = re + (i + j) * s_lanes + k;
+                            float* ai = im + (i + j) * s_lanes + k;
+                            float* br = re + (i + j + half) * s_lanes + k;
+                            float* bi = im + (i + j + half) * s_lanes + k;
+                            __m128 xr = _mm_loadu_ps(br);
+                            __m128 xi = _mm_loadu_ps(bi);
+                            __m128 tr = _mm_sub_ps(_mm_mul_ps(xr, wr), _mm_mul_ps(xi, wi));
+                            __m128 ti = _mm_add_ps(_mm_mul_ps(xr, wi), _mm_mul_ps(xi, wr));
+                            __m128 yr = _mm_loadu_ps(ar);
+                            __m128 yi = _mm_loadu_ps(ai);
+                            _mm_storeu_ps(br, _mm_sub_ps(yr, tr));
+                            _mm_storeu_ps(bi, _mm_sub_ps(yi, ti));
+                            _mm_storeu_ps(ar, _mm_add_ps(yr, tr));
+                            _mm_storeu_ps(ai, _mm_add_ps(yi, ti));
+                        }
+                    }
+                }
+            }
+        }
+
+        __attribute__((target("avx2"))) void butterflies_avx2(float* re, float* im, const float* twiddle_r, const float* twiddle_i, size_t size)
+        {
+            for (size_t half = 1; half < size; half <<= 1)
+            {
+                const size_t step = size / (half * 2);
+                for (size_t i = 0; i < size; i += half * 2)
+                {
+                    for (size_t j = 0; j < half; j++)
+                    {
+                        const __m256 wr = _mm256_set1_ps(twiddle_r[j * step]);
+                        const __m256 wi = _mm256_set1_ps(twiddle_i[j * step]);
+                        float* ar = re + (i + j) * s_lanes;
+                        float* ai = im + (i + j) * s_lanes;
+                        float* br = re + (i + j + half) * s_lanes;
+                        float* bi = im + (i + j + half) * s_lanes;
+                        __m256 xr = _mm256_loadu_ps(br);
+                        __m256 xi = _mm256_loadu_ps(bi);
+                        __m256 tr = _mm256_sub_ps(_mm256_mul_ps(xr, wr), _mm256_mul_ps(xi, wi));
+                        __m256 ti = _mm256_add_ps(_mm256_mul_ps(xr, wi), _mm256_mul_ps(xi, wr));
+                        __m256 yr = _mm256_loadu_ps(ar);
+                        __m256 yi = _mm256_loadu_ps(ai);
+                        _mm256_storeu_ps(br, _mm256_sub_ps(yr, tr));
+                        _mm256_storeu_ps(bi, _mm256_sub_ps(yi, ti));
+                        _mm256_storeu_ps(ar, _mm256_add_ps(yr, tr));
+                        _mm256_storeu_ps(ai, _mm256_add_ps(yi, ti));
+                    }
+                }
+            }
+        }
+#endif
+    }// namespace
+
+    BatchPlan::BatchPlan(size_t window_size)
+        : bit_reverse(FFTPlanCache::make_bit_reverse_table(window_size))
+    {
+        twiddle_r.resize(window_size / 2);
+        twiddle_i.resize(window_size / 2);
+        for (size_t i = 0; i < window_size / 2; i++)
+        {
+            double phase = -2 * M_PI * i / window_size;
+            twiddle_r[i] = static_cast<float>(cos(phase));
+            twiddle_i[i] = static_cast<float>(sin(phase));
+        }
+    }
+
+    BatchFFT::BatchFFT(WindowFunction w_func, size_t window_size)
+        : FFT(w_func, window_size)
+    {
+        release_assert(window_size >= 2 && (window_size & (window_size - 1)) == 0, "batched fft needs a power of two window_size")
+
+        m_plan = FFTPlanCache::instance().get_plan<BatchPlan>(m_window_size, [](size_t size)
+        {
+            return std::make_unique<BatchPlan>(size);
+        });
+        m_lanes_r.resize(m_window_size * s_lanes);
+        m_lanes_i.resize(m_window_size * s_lanes);
+    }
+
+    void BatchFFT::transform_lanes(const float* const* frames, size_t count)
+    {
+        using Kernel = void (*)(float*, float*, const float*, const float*, size_t);
+        static const Kernel s_kernel = []() -> Kernel
+        {
+            switch (simd::get_instruction_set())
+            {
+#ifdef SIREN_SIMD_X86
+            case simd::InstructionSet::AVX512:
+            case simd::InstructionSet::AVX2:
+                return butterflies_avx2;
+            case simd::InstructionSet::SSE2:
+                return butterflies_sse2;
+#endif
+            default:
+                return butterflies_scalar;
+            }
+        }();
+
+        // lane k holds frame k, unused lanes are zeroed so they cannot produce denormals or nans
+        for (size_t i = 0; i < m_window_size; i++)
+        {
+            float* re = m_lanes_r.data() + m_plan->bit_reverse[i] * s_lanes;
+            float* im = m_lanes_i.data() + m_plan->bit_reverse[i] * s_lanes;
+            for (size_t k = 0; k < s_lanes; k++)
+            {
+                re[k] = k < count ? frames[k][i] * m_window_func[i] : 0.0f;
+                im[k] = 0.0f;
+            }
+        }
+
+        s_kernel(m_lanes_r.data(), m_lanes_i.data(), m_plan->twiddle_r.data(), m_plan->twiddle_i.data(), m_window_size);
+    }
+
+    void BatchFFT::process_batch(const float* const* frames, size_t count, float* out_r, float* out_i)
+    {
+        const size_t bin_count = get_bin_count();
+        for (size_t first = 0; first < count; first += s_lanes)
+        {
+            const size_t lanes = std::min(s_lanes, count - first);
+            transform_lanes(frames + first, lanes);
+
+            for (size_t k = 0; k < lanes; k++)
+            {
+                float* row_r = out_r + (first + k) * bin_count;
+                float* row_i = out_i + (first + k) * bin_count;
+                for (size_t b = 0; b < bin_count; b++)
+                {
+                    row_r[b] = m_lanes_r[b * s_lanes + k];
+                    row_i[b] = m_lanes_i[b * s_lanes + k];
+                }
+            }
+        }
+    }
+
+    void BatchFFT::process_frame(const float* frame, float* out_r, float* out_i)
+    {
+        process_batch(&frame, 1, out_r, out_i);
+    }
+
+    std::unique_ptr<FFT> BatchFFT::clone() const
+    {
+        return std::make_unique<BatchFFT>(m_window_function, m_window_size);
+    }
+
+    size_t BatchFFT::get_bin_count() const
+    {
+        return m_window_size / 2 + 1;
+    }
+}// namespace siren
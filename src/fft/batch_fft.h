@@ -0,0 +1,49 @@
+#pragma once
+
+#include "fft.h"
+
+namespace siren
+{
+    /**
+    * bit-reversal permutation and twiddles of one window size, read-only once built
+    */
+    struct BatchPlan
+    {
+        explicit BatchPlan(size_t window_size);
+
+        std::vector<size_t> bit_reverse;
+        std::vector<float> twiddle_r;
+        std::vector<float> twiddle_i;
+    };
+
+    /**
+    * radix-2 transform that runs 8 windows side by side, every butterfly operates on one
+    * vector holding the same bin of 8 frames, so a batch costs about as much as a single
+    * scalar transform. window_size has to be a power of two, only the N/2+1 non-redundant
+    * bins are exposed
+    */
+    class BatchFFT : public FFT
+    {
+
+    public:
+        BatchFFT(WindowFunction w_func, size_t window_size);
+
+        void process_frame(const float* frame, float* out_r, float* out_i) override;
+
+        [[nodiscard]] std::unique_ptr<FFT> clone() const override;
+
+        void process_batch(const float* const* frames, size_t count, float* out_r, float* out_i) override;
+
+        [[nodiscard]] size_t get_bin_count() const override;
+
+        static constexpr size_t s_lanes = 8;
+
+    private:
+        void transform_lanes(const float* const* frames, size_t count);
+
+    private:
+        std::shared_ptr<const BatchPlan> m_plan;
+        std::vector<float> m_lanes_r; // bin-major, s_lanes frames per bin
+        std::vector<float> m_lanes_i;
+    };
+}// namespace siren
@@ -1,55 +1,68 @@
+#include <type_traits>
 #include "fft.h"
+#include "plan_cache.h"
+#include "../common/simd.h"
 
 namespace siren
 {
     FFT::FFT(WindowFunction w_func, size_t window_size)
+        : m_window_function(w_func),
+          m_window_size(window_size),
+          m_window_table(FFTPlanCache::instance().get_window(w_func, window_size)),
+          m_window_func(m_window_table->data())
     {
-        m_window_size = window_size;
-        switch (w_func)
-        {
-        case WindowFunction::Hanning:
-            config_hanning_window(window_size);
-            break;
-        case WindowFunction::Hamming:
-            config_hamming_window(window_size);
-            break;
-        case WindowFunction::Blackman:
-            config_blackman_window(window_size);
-            break;
-        }
     }
 
-    void FFT::config_hanning_window(size_t window_size)
+    void FFT::process_window(std::vector<float>&& window)
     {
-        float ws = window_size - 1;
-        std::vector<float> window_func(window_size);
-        for (size_t i = 0; i < window_size; i++)
-        {
-            window_func[i] = 0.5f * (1 - cos(2 * M_PI * (i / ws)));
-        }
-        m_window_func = std::move(window_func);
+        release_assert(window.size() == m_window_size, "window.size() != m_window_size");
+
+        // sized once, later calls reuse the same storage
+        m_fft_out_r.resize(get_bin_count());
+        m_fft_out_i.resize(get_bin_count());
+        process_frame(window.data(), m_fft_out_r.data(), m_fft_out_i.data());
     }
 
-    void FFT::config_hamming_window(size_t window_size)
+    void FFT::process_batch(const float* const* frames, size_t count, float* out_r, float* out_i)
     {
-        float ws = window_size - 1;
-        std::vector<float> window_func(window_size);
-        for (size_t i = 0; i < window_size; i++)
+        const size_t bin_count = get_bin_count();
+        for (size_t k = 0; k < count; k++)
         {
-            window_func[i] = 0.54f - (0.46f * cos(2 * M_PI * (i / ws)));
+            process_frame(frames[k], out_r + k * bin_count, out_i + k * bin_count);
         }
-        m_window_func = std::move(window_func);
     }
 
-    void FFT::config_blackman_window(size_t window_size)
+    void FFT::process_magnitudes(const float* const* frames, size_t count, float* magnitude, bool decibel)
     {
-        float ws = window_size - 1;
-        std::vector<float> window_func(window_size);
-        for (size_t i = 0; i < window_size; i++)
+        const size_t size = count * get_bin_count();
+        if (m_batch_out_r.size() < size)
+        {
+            m_batch_out_r.resize(size);
+            m_batch_out_i.resize(size);
+        }
+        process_batch(frames, count, m_batch_out_r.data(), m_batch_out_i.data());
+
+        if (decibel)
         {
-            window_func[i] = 0.42f - 0.5 * cos((2 * M_PI * i)/(ws - 1)) + 0.08f * cos((4 * M_PI * i)/(ws - 1));
+            simd::magnitude_db(m_batch_out_r.data(), m_batch_out_i.data(), magnitude, size);
+            return;
         }
-        m_window_func = std::move(window_func);
+        simd::magnitude(m_batch_out_r.data(), m_batch_out_i.data(), magnitude, size);
+    }
+
+    void FFT::process_magnitudes_fixed(const float* const*, size_t, int32_t*)
+    {
+        release_assert(false, "process_magnitudes_fixed needs a fixed-point backend")
+    }
+
+    size_t FFT::get_bin_count() const
+    {
+        return m_window_size;
+    }
+
+    bool FFT::is_fixed_point() const
+    {
+        return false;
     }
 
     size_t FFT::get_fft_size() const
@@ -76,8 +89,10 @@ namespace siren
     KissFFT::KissFFT(WindowFunction w_func, size_t window_size)
         : FFT(w_func, window_size)
     {
-        release_assert(window_size < INT_MAX, "window_size exceeds INT_MAX limit")
-        config = kiss_fft_alloc((int)m_window_size, 0, nullptr, nullptr);
+        m_plan = FFTPlanCache::instance().get_plan<KissPlan>(m_window_size, [](size_t size)
+        {
+            return std::make_unique<KissPlan>(size);
+        });
         fft_in = new kiss_fft_cpx[m_window_size];
         fft_out = new kiss_fft_cpx[m_window_size];
     }
@@ -86,29 +101,85 @@ namespace siren
     {
         delete[] fft_out;
         delete[] fft_in;
-        kiss_fft_free(config);
     }
 
-    void KissFFT::process_window(std::vector<float>&& window)
+    void KissFFT::process_frame(const float* frame, float* out_r, float* out_i)
     {
-        release_assert(window.size() == m_window_size, "window.size() != m_window_size");
+        if constexpr (std::is_same_v<kiss_fft_scalar, float>)
+        {
+            simd::apply_window_complex(frame, m_window_func, reinterpret_cast<float*>(fft_in), m_window_size);
+        }
+        else
+        {
+            for (size_t i = 0; i < m_window_size; i++)
+            {
+                fft_in[i].r = frame[i] * m_window_func[i];
+                fft_in[i].i = 0.0f;
+            }
+        }
+
+        kiss_fft(m_plan->config, fft_in, fft_out);
 
-        std::vector<float> fft_out_r, fft_out_i;
         for (size_t i = 0; i < m_window_size; i++)
         {
-            fft_in[i].r = window[i] * m_window_func[i];
-            fft_in[i].i = 0.0f;
+            out_r[i] = static_cast<float>(fft_out[i].r);
+            out_i[i] = static_cast<float>(fft_out[i].i);
         }
+    }
 
-        kiss_fft(config, fft_in, fft_out);
+    std::unique_ptr<FFT> KissFFT::clone() const
+    {
+        return std::make_unique<KissFFT>(m_window_function, m_window_size);
+    }
 
-        for (size_t i = 0; i < m_window_size; i++)
+    KissFFTR::KissFFTR(WindowFunction w_func, size_t window_size)
+        : FFT(w_func, window_size)
+    {
+        release_assert(window_size < INT_MAX, "window_size exceeds INT_MAX limit")
+        release_assert(window_size % 2 == 0, "real fft needs an even window_size")
+        // kiss_fftr writes into a scratch buffer inside its cfg, so unlike KissPlan it cannot be shared
+        config = kiss_fftr_alloc((int)m_window_size, 0, nullptr, nullptr);
+        fft_in = new kiss_fft_scalar[m_window_size];
+        fft_out = new kiss_fft_cpx[m_window_size / 2 + 1];
+    }
+
+    KissFFTR::~KissFFTR()
+    {
+        delete[] fft_out;
+        delete[] fft_in;
+        kiss_fftr_free(config);
+    }
+
+    void KissFFTR::process_frame(const float* frame, float* out_r, float* out_i)
+    {
+        if constexpr (std::is_same_v<kiss_fft_scalar, float>)
+        {
+            simd::apply_window(frame, m_window_func, fft_in, m_window_size);
+        }
+        else
         {
-            fft_out_r.push_back(static_cast<float>(fft_out[i].r));
-            fft_out_i.push_back(static_cast<float>(fft_out[i].i));
+            for (size_t i = 0; i < m_window_size; i++)
+            {
+                fft_in[i] = frame[i] * m_window_func[i];
+            }
         }
 
-        m_fft_out_r = std::move(fft_out_r);
-        m_fft_out_i = std::move(fft_out_i);
+        kiss_fftr(config, fft_in, fft_out);
+
+        for (size_t i = 0; i < m_window_size / 2 + 1; i++)
+        {
+            out_r[i] = static_cast<float>(fft_out[i].r);
+            out_i[i] = static_cast<float>(fft_out[i].i);
+        }
+    }
+
+    std::unique_ptr<FFT> KissFFTR::clone() const
+    {
+        return std::make_unique<KissFFTR>(m_window_function, m_window_size);
+    }
+
+    size_t KissFFTR::get_bin_count() const
+    {
+        return m_window_size / 2 + 1;
     }
-}// namespace siren
\ No newline at end of file
+}// namespace siren
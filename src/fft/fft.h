@@ -3,8 +3,11 @@
 #include <iostream>
 #include <cmath>
 #include <climits>
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <kiss_fft.h>
+#include <kiss_fftr.h>
 #include "../common/common.h"
 
 namespace siren
@@ -16,6 +19,14 @@ namespace siren
         Blackman
     };
 
+    enum class FFTBackend
+    {
+        KissComplex,
+        KissReal,
+        Batched,
+        FixedPoint
+    };
+
     class FFT
     {
 
@@ -23,26 +34,66 @@ namespace siren
         FFT(WindowFunction w_func, size_t window_size);
         virtual ~FFT() = default;
 
-        virtual void process_window(std::vector<float>&& window) = 0;
+        /**
+        * transforms window_size samples starting at frame, out_r and out_i must hold get_bin_count()
+        * floats. nothing is allocated, so frame can point straight into the pcm buffer
+        */
+        virtual void process_frame(const float* frame, float* out_r, float* out_i) = 0;
+
+        /**
+        * transforms a single window into the buffers behind get_real_by_idx and get_imag_by_idx
+        */
+        void process_window(std::vector<float>&& window);
+
+        /**
+        * transforms count windows of window_size samples in one call, row k of out_r and out_i
+        * (get_bin_count() floats each) receives the bins of frames[k]. the default implementation
+        * loops over process_frame, backends that can share work between frames override it
+        */
+        virtual void process_batch(const float* const* frames, size_t count, float* out_r, float* out_i);
+
+        /**
+        * same as process_batch but stores only the magnitude of every bin, row k of magnitude
+        * holds get_bin_count() floats. decibel switches the output to 20 * log10(magnitude)
+        */
+        virtual void process_magnitudes(const float* const* frames, size_t count, float* magnitude, bool decibel = false);
 
+        /**
+        * magnitudes as Q15 integers in units of 1 / FixedPointFFT::s_one, without a float round trip,
+        * only backends with is_fixed_point() implement it
+        */
+        virtual void process_magnitudes_fixed(const float* const* frames, size_t count, int32_t* magnitude);
+
+        /**
+        * fresh instance with the same backend, window function and size, used to give each thread its own scratch state
+        */
+        [[nodiscard]] virtual std::unique_ptr<FFT> clone() const = 0;
+
+        [[nodiscard]] virtual size_t get_bin_count() const;
+
+        /**
+        * true when bins are integers in units of 1 / FixedPointFFT::s_one, see FixedPointFFT
+        */
+        [[nodiscard]] virtual bool is_fixed_point() const;
         [[nodiscard]] size_t get_fft_size() const;
         [[nodiscard]] size_t get_window_size() const;
         [[nodiscard]] float get_real_by_idx(size_t i) const;
         [[nodiscard]] float get_imag_by_idx(size_t i) const;
 
-    private:
-        void config_hanning_window(size_t window_size);
-        void config_hamming_window(size_t window_size);
-        void config_blackman_window(size_t window_size);
-
     protected:
+        WindowFunction m_window_function;
         size_t m_window_size;
 
-        std::vector<float> m_window_func;
+        std::shared_ptr<const std::vector<float>> m_window_table; // shared through FFTPlanCache
+        const float* m_window_func;
         std::vector<float> m_fft_out_r;
         std::vector<float> m_fft_out_i;
+        std::vector<float> m_batch_out_r;
+        std::vector<float> m_batch_out_i;
     };
 
+    struct KissPlan;
+
     class KissFFT : public FFT
     {
 
@@ -50,11 +101,36 @@ namespace siren
         KissFFT(WindowFunction w_func, size_t window_size);
         ~KissFFT();
 
-        void process_window(std::vector<float>&& window) override;
+        void process_frame(const float* frame, float* out_r, float* out_i) override;
+
+        [[nodiscard]] std::unique_ptr<FFT> clone() const override;
 
     private:
         kiss_fft_cpx* fft_in;
         kiss_fft_cpx* fft_out;
-        kiss_fft_cfg config;
+        std::shared_ptr<const KissPlan> m_plan;
+    };
+
+    /**
+    * real-input transform over kiss_fftr, only the N/2+1 non-redundant bins are computed
+    * and exposed, window_size has to be even
+    */
+    class KissFFTR : public FFT
+    {
+
+    public:
+        KissFFTR(WindowFunction w_func, size_t window_size);
+        ~KissFFTR();
+
+        void process_frame(const float* frame, float* out_r, float* out_i) override;
+
+        [[nodiscard]] std::unique_ptr<FFT> clone() const override;
+
+        [[nodiscard]] size_t get_bin_count() const override;
+
+    private:
+        kiss_fft_scalar* fft_in;
+        kiss_fft_cpx* fft_out;
+        kiss_fftr_cfg config;
     };
 }// namespace siren
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <cmath>
+#include "filterbank.h"
+#include "fixed_fft.h"
+#include "../common/common.h"
+#include "../common/simd.h"
+
+namespace siren
+{
+    namespace
+    {
+        double to_scale(FrequencyScale scale, double frequency)
+        {
+            return scale == FrequencyScale::Mel ? 2595.0 * std::log10(1.0 + frequency / 700.0) : std::log(frequency);
+        }
+
+        double from_scale(FrequencyScale scale, double value)
+        {
+            return scale == FrequencyScale::Mel ? 700.0 * (std::pow(10.0, value / 2595.0) - 1.0) : std::exp(value);
+        }
+
+        /**
+        * filter_count + 2 edges evenly spaced on the scale, filter i spans edges i to i + 2 and peaks at i + 1
+        */
+        std::vector<double> make_edges(FrequencyScale scale, size_t filter_count, double low, double high)
+        {
+            std::vector<double> edges(filter_count + 2);
+            for (size_t i = 0; i < edges.size(); i++)
+            {
+                edges[i] = from_scale(scale, low + (high - low) * i / (filter_count + 1));
+            }
+            return edges;
+        }
+
+        bool has_distinct_rows(const std::vector<double>& edges)
+        {
+            for (size_t i = 2; i + 1 < edges.size(); i++)
+            {
+                // centres are stored as float, truncate what will be stored
+                if (static_cast<size_t>(static_cast<float>(edges[i])) <= static_cast<size_t>(static_cast<float>(edges[i - 1])))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }// namespace
+
+    Filterbank::Filterbank(FrequencyScale scale, size_t filter_count, size_t window_size, unsigned int sampling_rate)
+        : m_window_size(window_size), m_sampling_rate(sampling_rate)
+    {
+        release_assert(scale != FrequencyScale::Linear, "a linear scale needs no filterbank")
+        release_assert(filter_count > 0, "filterbank needs at least one filter")
+
+        const double bin_width = static_cast<double>(sampling_rate) / window_size;
+        const double nyquist = sampling_rate / 2;
+        const double low = to_scale(scale, bin_width);
+        const double high = to_scale(scale, nyquist);
+
+        // the sparse layout keys filters by their centre truncated to Hz, filters sharing a row would be
+        // summed by setFromTriplets, so the count is lowered to the largest one found with distinct rows
+        std::vector<double> edges = make_edges(scale, filter_count, low, high);
+        if (!has_distinct_rows(edges))
+        {
+            size_t valid = 1;
+            size_t invalid = filter_count;
+            while (invalid - valid > 1)
+            {
+                const size_t count = valid + (invalid - valid) / 2;
+                if (has_distinct_rows(make_edges(scale, count, low, high)))
+                {
+                    valid = count;
+                }
+                else
+                {
+                    invalid = count;
+                }
+            }
+            filter_count = valid;
+            edges = make_edges(scale, filter_count, low, high);
+        }
+
+        for (size_t f_idx = 0; f_idx < filter_count; f_idx++)
+        {
+            const double left = edges[f_idx];
+            const double centre = edges[f_idx + 1];
+            const double right = edges[f_idx + 2];
+
+            Filter filter{0, m_weights.size(), 0};
+            double sum = 0;
+            for (size_t b_idx = static_cast<size_t>(std::ceil(left / bin_width)); b_idx * bin_width < right && b_idx * bin_width < nyquist; b_idx++)
+            {
+                double frequency = b_idx * bin_width;
+                double weight = frequency <= centre ? (frequency - left) / (centre - left) : (right - frequency) / (right - centre);
+                if (weight <= 0)
+                {
+                    continue;
+                }
+                if (filter.bin_count == 0)
+                {
+                    filter.first_bin = b_idx;
+                }
+                // bins between the first and this one had zero weight, keep the run contiguous
+                m_weights.resize(filter.weight_offset + b_idx - filter.first_bin, 0.0f);
+                m_weights.push_back(static_cast<float>(weight));
+                filter.bin_count = b_idx - filter.first_bin + 1;
+                sum += weight;
+            }
+            if (filter.bin_count == 0)
+            {
+                filter.first_bin = std::min<size_t>(std::lround(centre / bin_width), window_size / 2 - 1);
+                filter.bin_count = 1;
+                m_weights.push_back(1.0f);
+                sum = 1;
+            }
+            for (size_t w_idx = filter.weight_offset; w_idx < m_weights.size(); w_idx++)
+            {
+                m_weights[w_idx] = static_cast<float>(m_weights[w_idx] / sum);
+            }
+            m_filters.push_back(filter);
+            m_centre_frequencies.push_back(static_cast<float>(centre));
+        }
+
+        m_fixed_weights.resize(m_weights.size());
+        std::transform(m_weights.begin(), m_weights.end(), m_fixed_weights.begin(), [](float weight)
+        {
+            return static_cast<int32_t>(std::lround(weight * FixedPointFFT::s_one));
+        });
+    }
+
+    void Filterbank::apply(const float* magnitude, float* output) const
+    {
+        for (size_t f_idx = 0; f_idx < m_filters.size(); f_idx++)
+        {
+            const Filter& filter = m_filters[f_idx];
+            output[f_idx] = simd::dot_product(m_weights.data() + filter.weight_offset, magnitude + filter.first_bin, filter.bin_count);
+        }
+    }
+
+    void Filterbank::apply(const int32_t* magnitude, int32_t* output) const
+    {
+        for (size_t f_idx = 0; f_idx < m_filters.size(); f_idx++)
+        {
+            const Filter& filter = m_filters[f_idx];
+            const int32_t* weights = m_fixed_weights.data() + filter.weight_offset;
+            int64_t sum = 0;
+            for (size_t b_idx = 0; b_idx < filter.bin_count; b_idx++)
+            {
+                sum += (int64_t)weights[b_idx] * magnitude[filter.first_bin + b_idx];
+            }
+            output[f_idx] = static_cast<int32_t>((sum + (1 << 14)) >> 15);
+        }
+    }
+
+    size_t Filterbank::get_filter_count() const
+    {
+        return m_filters.size();
+    }
+
+    size_t Filterbank::get_window_size() const
+    {
+        return m_window_size;
+    }
+
+    unsigned int Filterbank::get_sampling_rate() const
+    {
+        return m_sampling_rate;
+    }
+
+    const std::vector<float>& Filterbank::get_centre_frequencies() const
+    {
+        return m_centre_frequencies;
+    }
+}// namespace siren
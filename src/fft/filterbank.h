@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace siren
+{
+    enum class FrequencyScale
+    {
+        Linear,
+        Log,
+        Mel
+    };
+
+    /**
+    * triangular filters spaced evenly on a log or mel scale between the first non-dc bin and nyquist,
+    * stored sparsely as the run of bins each filter covers. every filter's weights sum to 1, so its
+    * output is a weighted mean of the magnitudes and z-scores stay comparable between wide and narrow
+    * filters. filters narrower than a bin fall back to the bin nearest their centre. a filter_count
+    * that would put two centres in the same Hz is lowered, get_filter_count returns what was kept
+    */
+    class Filterbank
+    {
+    public:
+        Filterbank(FrequencyScale scale, size_t filter_count, size_t window_size, unsigned int sampling_rate);
+
+        /**
+        * magnitude holds the bins of one frame, output receives get_filter_count() values
+        */
+        void apply(const float* magnitude, float* output) const;
+
+        /**
+        * same on the Q15 magnitudes of a fixed-point fft, the weights are rounded to Q15 as well
+        */
+        void apply(const int32_t* magnitude, int32_t* output) const;
+
+        [[nodiscard]] size_t get_filter_count() const;
+
+        [[nodiscard]] size_t get_window_size() const;
+
+        [[nodiscard]] unsigned int get_sampling_rate() const;
+
+        /**
+        * centre of every filter in Hz, ascending
+        */
+        [[nodiscard]] const std::vector<float>& get_centre_frequencies() const;
+
+    private:
+        struct Filter
+        {
+            size_t first_bin;
+            size_t weight_offset;
+            size_t bin_count;
+        };
+
+    private:
+        size_t m_window_size;
+        unsigned int m_sampling_rate;
+        std::vector<Filter> m_filters;
+        std::vector<float> m_weights;
+        std::vector<int32_t> m_fixed_weights;
+        std::vector<float> m_centre_frequencies;
+    };
+}// namespace siren
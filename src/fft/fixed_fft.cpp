@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <cstring>
+#include "fixed_fft.h"
+#include "plan_cache.h"
+
+namespace siren
+{
+    namespace
+    {
+        constexpr int s_twiddle_bits = 30;
+        constexpr int64_t s_twiddle_round = (int64_t)1 << (s_twiddle_bits - 1);
+
+        int16_t to_q15(float value)
+        {
+            // value * 2^15 rounded half away from zero, read from the ieee 754 fields so that
+            // targets with a soft-float abi convert samples without any emulated float operation
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            const bool negative = bits >> 31;
+            const int exponent = static_cast<int>((bits >> 23) & 0xff);
+            if (exponent == 0xff)
+            {
+                return negative ? INT16_MIN : INT16_MAX;
+            }
+            if (exponent == 0)
+            {
+                return 0;
+            }
+
+            // |value| * 2^15 = mantissa * 2^(exponent - 135)
+            const int64_t mantissa = (bits & 0x7fffff) | 0x800000;
+            const int shift = exponent - 135;
+            int64_t q = 0;
+            if (shift >= 0)
+            {
+                q = shift > 16 ? INT16_MAX + 1 : mantissa << shift;
+            }
+            else if (shift >= -25)
+            {
+                q = (mantissa + ((int64_t)1 << (-shift - 1))) >> -shift;
+            }
+            q = negative ? -q : q;
+            return static_cast<int16_t>(std::clamp<int64_t>(q, INT16_MIN, INT16_MAX));
+        }
+
+        uint64_t isqrt(uint64_t value)
+        {
+            // digit by digit, one bit of the root per iteration
+            uint64_t root = 0;
+            uint64_t bit = (uint64_t)1 << 62;
+            while (bit > value)
+            {
+                bit >>= 2;
+            }
+            while (bit)
+            {
+                if (value >= root + bit)
+                {
+                    value -= root + bit;
+                    root = (root >> 1) + bit;
+                }
+                else
+                {
+                    root >>= 1;
+                }
+                bit >>= 2;
+            }
+            return root;
+        }
+    }// namespace
+
+    FixedPointPlan::FixedPointPlan(size_t window_size)
+        : bit_reverse(FFTPlanCache::make_bit_reverse_table(window_size))
+    {
+        twiddle_r.resize(window_size / 2);
+        twiddle_i.resize(window_size / 2);
+        for (size_t i = 0; i < window_size / 2; i++)
+        {
+            double phase = -2 * M_PI * i / window_size;
+            twiddle_r[i] = static_cast<int32_t>(std::lround(cos(phase) * (1 << s_twiddle_bits)));
+            twiddle_i[i] = static_cast<int32_t>(std::lround(sin(phase) * (1 << s_twiddle_bits)));
+        }
+    }
+
+    FixedPointFFT::FixedPointFFT(WindowFunction w_func, size_t window_size)
+        : FFT(w_func, window_size)
+    {
+        release_assert(window_size >= 2 && (window_size & (window_size - 1)) == 0, "fixed-point fft needs a power of two window_size")
+        release_assert(window_size <= 32768, "fixed-point fft overflows int32 above 32768 bins")
+
+        m_plan = FFTPlanCache::instance().get_plan<FixedPointPlan>(m_window_size, [](size_t size)
+        {
+            return std::make_unique<FixedPointPlan>(size);
+        });
+
+        m_window_q15.resize(m_window_size);
+        for (size_t i = 0; i < m_window_size; i++)
+        {
+            m_window_q15[i] = to_q15(m_window_func[i]);
+        }
+        m_fft_r.resize(m_window_size);
+        m_fft_i.resize(m_window_size);
+    }
+
+    void FixedPointFFT::transform(const float* frame)
+    {
+        for (size_t i = 0; i < m_window_size; i++)
+        {
+            int32_t windowed = ((int32_t)to_q15(frame[i]) * m_window_q15[i] + (1 << 14)) >> 15;
+            m_fft_r[m_plan->bit_reverse[i]] = windowed;
+            m_fft_i[m_plan->bit_reverse[i]] = 0;
+        }
+
+        const int32_t* twiddle_r = m_plan->twiddle_r.data();
+        const int32_t* twiddle_i = m_plan->twiddle_i.data();
+        for (size_t half = 1; half < m_window_size; half <<= 1)
+        {
+            const size_t step = m_window_size / (half * 2);
+            for (size_t i = 0; i < m_window_size; i += half * 2)
+            {
+                for (size_t j = 0; j < half; j++)
+                {
+                    const int64_t wr = twiddle_r[j * step];
+                    const int64_t wi = twiddle_i[j * step];
+                    const int64_t br = m_fft_r[i + j + half];
+                    const int64_t bi = m_fft_i[i + j + half];
+                    int32_t tr = (int32_t)((br * wr - bi * wi + s_twiddle_round) >> s_twiddle_bits);
+                    int32_t ti = (int32_t)((br * wi + bi * wr + s_twiddle_round) >> s_twiddle_bits);
+                    m_fft_r[i + j + half] = m_fft_r[i + j] - tr;
+                    m_fft_i[i + j + half] = m_fft_i[i + j] - ti;
+                    m_fft_r[i + j] += tr;
+                    m_fft_i[i + j] += ti;
+                }
+            }
+        }
+    }
+
+    void FixedPointFFT::process_frame_fixed(const float* frame, int32_t* out_r, int32_t* out_i)
+    {
+        transform(frame);
+        std::copy_n(m_fft_r.begin(), get_bin_count(), out_r);
+        std::copy_n(m_fft_i.begin(), get_bin_count(), out_i);
+    }
+
+    void FixedPointFFT::process_frame(const float* frame, float* out_r, float* out_i)
+    {
+        transform(frame);
+        for (size_t i = 0; i < get_bin_count(); i++)
+        {
+            out_r[i] = static_cast<float>(m_fft_r[i]) / s_one;
+            out_i[i] = static_cast<float>(m_fft_i[i]) / s_one;
+        }
+    }
+
+    void FixedPointFFT::process_magnitudes_fixed(const float* const* frames, size_t count, int32_t* magnitude)
+    {
+        const size_t bin_count = get_bin_count();
+        for (size_t k = 0; k < count; k++)
+        {
+            transform(frames[k]);
+
+            int32_t* row = magnitude + k * bin_count;
+            for (size_t i = 0; i < bin_count; i++)
+            {
+                int64_t r = m_fft_r[i];
+                int64_t im = m_fft_i[i];
+                row[i] = static_cast<int32_t>(isqrt(r * r + im * im));
+            }
+        }
+    }
+
+    void FixedPointFFT::process_magnitudes(const float* const* frames, size_t count, float* magnitude, bool decibel)
+    {
+        const size_t bin_count = get_bin_count();
+        m_fixed_magnitude.resize(bin_count);
+        for (size_t k = 0; k < count; k++)
+        {
+            process_magnitudes_fixed(frames + k, 1, m_fixed_magnitude.data());
+
+            float* row = magnitude + k * bin_count;
+            for (size_t i = 0; i < bin_count; i++)
+            {
+                row[i] = static_cast<float>(m_fixed_magnitude[i]) / s_one;
+                if (decibel)
+                {
+                    row[i] = row[i] > 0 ? 20.0f * std::log10(row[i]) : -120.0f;
+                }
+            }
+        }
+    }
+
+    std::unique_ptr<FFT> FixedPointFFT::clone() const
+    {
+        return std::make_unique<FixedPointFFT>(m_window_function, m_window_size);
+    }
+
+    size_t FixedPointFFT::get_bin_count() const
+    {
+        return m_window_size / 2 + 1;
+    }
+
+    bool FixedPointFFT::is_fixed_point() const
+    {
+        return true;
+    }
+}// namespace siren
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include "fft.h"
+
+namespace siren
+{
+    /**
+    * BatchPlan counterpart with the twiddles rounded to Q30 integers
+    */
+    struct FixedPointPlan
+    {
+        explicit FixedPointPlan(size_t window_size);
+
+        std::vector<size_t> bit_reverse;
+        std::vector<int32_t> twiddle_r;
+        std::vector<int32_t> twiddle_i;
+    };
+
+    /**
+    * integer radix-2 transform for targets without a fast fpu. samples and window are
+    * quantized to Q15 int16, butterflies run on int32 with int64 products and Q30 twiddles,
+    * so the bins stay in Q15 units of the float transform without per-stage scaling.
+    * magnitudes are integer square roots, nothing between the float samples and the Q15 magnitudes
+    * runs a float operation. window_size has to be a power of two no larger than 32768, only the
+    * N/2+1 non-redundant bins are exposed
+    */
+    class FixedPointFFT : public FFT
+    {
+
+    public:
+        static constexpr int32_t s_one = 1 << 15;
+
+        FixedPointFFT(WindowFunction w_func, size_t window_size);
+
+        /**
+        * bins as Q15 integers, out_r and out_i must hold get_bin_count() values
+        */
+        void process_frame_fixed(const float* frame, int32_t* out_r, int32_t* out_i);
+
+        void process_frame(const float* frame, float* out_r, float* out_i) override;
+
+        /**
+        * magnitudes converted to float, for callers of the generic interface, the spectrogram uses process_magnitudes_fixed
+        */
+        void process_magnitudes(const float* const* frames, size_t count, float* magnitude, bool decibel = false) override;
+
+        void process_magnitudes_fixed(const float* const* frames, size_t count, int32_t* magnitude) override;
+
+        [[nodiscard]] std::unique_ptr<FFT> clone() const override;
+
+        [[nodiscard]] size_t get_bin_count() const override;
+
+        [[nodiscard]] bool is_fixed_point() const override;
+
+    private:
+        void transform(const float* frame);
+
+    private:
+        std::shared_ptr<const FixedPointPlan> m_plan;
+        std::vector<int16_t> m_window_q15;
+        std::vector<int32_t> m_fft_r;
+        std::vector<int32_t> m_fft_i;
+        std::vector<int32_t> m_fixed_magnitude;
+    };
+}// namespace siren
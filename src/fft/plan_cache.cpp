@@ -0,0 +1,99 @@
+#include "plan_cache.h"
+
+namespace siren
+{
+
+    KissPlan::KissPlan(size_t window_size)
+    {
+        release_assert(window_size < INT_MAX, "window_size exceeds INT_MAX limit")
+        config = kiss_fft_alloc((int)window_size, 0, nullptr, nullptr);
+    }
+
+    KissPlan::~KissPlan()
+    {
+        kiss_fft_free(config);
+    }
+
+    FFTPlanCache& FFTPlanCache::instance()
+    {
+        static FFTPlanCache s_instance;
+        return s_instance;
+    }
+
+    std::vector<size_t> FFTPlanCache::make_bit_reverse_table(size_t window_size)
+    {
+        size_t bits = 0;
+        while (((size_t)1 << bits) < window_size)
+        {
+            bits++;
+        }
+        std::vector<size_t> bit_reverse(window_size);
+        for (size_t i = 0; i < window_size; i++)
+        {
+            size_t reversed = 0;
+            for (size_t b = 0; b < bits; b++)
+            {
+                reversed |= ((i >> b) & 1) << (bits - 1 - b);
+            }
+            bit_reverse[i] = reversed;
+        }
+        return bit_reverse;
+    }
+
+    std::shared_ptr<const std::vector<float>> FFTPlanCache::get_window(WindowFunction w_func, size_t window_size)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto& window = m_windows[{w_func, window_size}];
+        if (!window)
+        {
+            switch (w_func)
+            {
+            case WindowFunction::Hanning:
+                window = std::make_shared<const std::vector<float>>(make_hanning_window(window_size));
+                break;
+            case WindowFunction::Hamming:
+                window = std::make_shared<const std::vector<float>>(make_hamming_window(window_size));
+                break;
+            case WindowFunction::Blackman:
+                window = std::make_shared<const std::vector<float>>(make_blackman_window(window_size));
+                break;
+            }
+        }
+        return window;
+    }
+
+    std::vector<float> FFTPlanCache::make_hanning_window(size_t window_size)
+    {
+        float ws = window_size - 1;
+        std::vector<float> window_func(window_size);
+        for (size_t i = 0; i < window_size; i++)
+        {
+            window_func[i] = 0.5f * (1 - cos(2 * M_PI * (i / ws)));
+        }
+        return window_func;
+    }
+
+    std::vector<float> FFTPlanCache::make_hamming_window(size_t window_size)
+    {
+        float ws = window_size - 1;
+        std::vector<float> window_func(window_size);
+        for (size_t i = 0; i < window_size; i++)
+        {
+            window_func[i] = 0.54f - (0.46f * cos(2 * M_PI * (i / ws)));
+        }
+        return window_func;
+    }
+
+    std::vector<float> FFTPlanCache::make_blackman_window(size_t window_size)
+    {
+        float ws = window_size - 1;
+        std::vector<float> window_func(window_size);
+        for (size_t i = 0; i < window_size; i++)
+        {
+            window_func[i] = 0.42f - 0.5 * cos((2 * M_PI * i)/(ws - 1)) + 0.08f * cos((4 * M_PI * i)/(ws - 1));
+        }
+        return window_func;
+    }
+
+}// namespace siren
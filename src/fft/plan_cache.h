@@ -0,0 +1,76 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <typeindex>
+#include <utility>
+#include <vector>
+
+#include "fft.h"
+
+namespace siren
+{
+
+    /**
+    * immutable complex kiss_fft plan, kiss_fft only reads it so one plan serves any number of threads
+    */
+    struct KissPlan
+    {
+        explicit KissPlan(size_t window_size);
+        ~KissPlan();
+
+        KissPlan(const KissPlan&) = delete;
+        KissPlan& operator=(const KissPlan&) = delete;
+
+        kiss_fft_cfg config;
+    };
+
+    /**
+    * process-wide, thread-safe store of window tables and fft plans, every FFT of the same
+    * size and window function shares them instead of recomputing them per instance. entries
+    * live as long as the process, there are only as many as distinct window sizes in use
+    */
+    class FFTPlanCache
+    {
+    public:
+        static FFTPlanCache& instance();
+
+        [[nodiscard]] std::shared_ptr<const std::vector<float>> get_window(WindowFunction w_func, size_t window_size);
+
+        /**
+        * index permutation of an in-place radix-2 transform, window_size has to be a power of two
+        */
+        static std::vector<size_t> make_bit_reverse_table(size_t window_size);
+
+        /**
+        * returns the plan of type Plan built for window_size, make_plan(window_size) is called
+        * under the lock on the first request only
+        */
+        template<typename Plan, typename Factory>
+        [[nodiscard]] std::shared_ptr<const Plan> get_plan(size_t window_size, Factory&& make_plan)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto& plan = m_plans[{std::type_index(typeid(Plan)), window_size}];
+            if (!plan)
+            {
+                plan = std::shared_ptr<const Plan>(make_plan(window_size));
+            }
+            return std::static_pointer_cast<const Plan>(plan);
+        }
+
+    private:
+        FFTPlanCache() = default;
+
+        static std::vector<float> make_hanning_window(size_t window_size);
+        static std::vector<float> make_hamming_window(size_t window_size);
+        static std::vector<float> make_blackman_window(size_t window_size);
+
+    private:
+        std::map<std::pair<WindowFunction, size_t>, std::shared_ptr<const std::vector<float>>> m_windows;
+        std::map<std::pair<std::type_index, size_t>, std::shared_ptr<const void>> m_plans;
+        std::mutex m_mutex;
+    };
+
+}// namespace siren
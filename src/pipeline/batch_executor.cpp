@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "batch_executor.h"
+#include "bounded_queue.h"
+
+namespace siren::pipeline
+{
+
+    namespace
+    {
+        template<typename Payload>
+        struct Job
+        {
+            size_t index;
+            std::unique_ptr<Payload> payload;
+            // empty when the spectrogram cache is disabled, the stage that makes a payload stores it under its key
+            std::string spectrogram_key;
+            std::string peak_key;
+        };
+
+        /**
+        * spawns workers that run body until it returns false, the last one to finish calls on_finish
+        */
+        template<typename Body, typename OnFinish>
+        void spawn_stage(std::vector<std::thread>& threads, size_t workers, Body body, OnFinish on_finish)
+        {
+            workers = std::max<size_t>(workers, 1);
+            auto remaining = std::make_shared<std::atomic<size_t>>(workers);
+            for (size_t i = 0; i < workers; i++)
+            {
+                threads.emplace_back([body, on_finish, remaining]() mutable
+                {
+                    while (body())
+                    {
+                    }
+                    if (remaining->fetch_sub(1) == 1)
+                    {
+                        on_finish();
+                    }
+                });
+            }
+        }
+    }// namespace
+
+    BatchExecutor::BatchExecutor(const SirenCore& core, PipelineParameters params)
+        : m_core(core), m_params(params)
+    {
+    }
+
+    void BatchExecutor::run(const std::vector<std::string>& track_paths, const Callback& callback) const
+    {
+        using PCMJob = Job<siren::audio::PCM>;
+        using SpectrogramJob = Job<siren::Spectrogram>;
+        using PeakJob = Job<siren::PeakSpectrogram>;
+
+        BoundedQueue<PCMJob> decoded(m_params.queue_capacity);
+        BoundedQueue<SpectrogramJob> transformed(m_params.queue_capacity);
+        BoundedQueue<PeakJob> peaks(m_params.queue_capacity);
+
+        std::mutex callback_mutex;
+        auto deliver = [&callback, &callback_mutex](size_t index, CoreReturnType&& result)
+        {
+            std::lock_guard lock(callback_mutex);
+            callback(index, std::move(result));
+        };
+
+        std::atomic<size_t> next_track{0};
+        std::vector<std::thread> threads;
+
+        spawn_stage(threads, m_params.decode_workers, [&]()
+        {
+            size_t index = next_track.fetch_add(1);
+            if (index >= track_paths.size())
+            {
+                return false;
+            }
+            // a cached stage skips everything before it, as in SirenCore::make_fingerprint
+            std::string spectrogram_key, peak_key;
+            if (m_core.make_stage_keys(track_paths[index], {}, spectrogram_key, peak_key))
+            {
+                if (auto peak_spectrogram = siren::PeakSpectrogram::load(m_core.get_stage_path(peak_key), peak_key))
+                {
+                    peaks.push({index, std::move(peak_spectrogram), spectrogram_key, peak_key});
+                    return true;
+                }
+                if (auto spectrogram = siren::Spectrogram::load(m_core.get_stage_path(spectrogram_key), spectrogram_key))
+                {
+                    transformed.push({index, std::move(spectrogram), spectrogram_key, peak_key});
+                    return true;
+                }
+            }
+
+            std::unique_ptr<siren::audio::PCM> audio = m_core.decode_track(track_paths[index]);
+            if (!audio)
+            {
+                CoreReturnType result;
+                result.code = CoreStatus::TargetFileDoesNotExist;
+                deliver(index, std::move(result));
+                return true;
+            }
+            decoded.push({index, std::move(audio), spectrogram_key, peak_key});
+            return true;
+        }, [&decoded]() { decoded.close(); });
+
+        spawn_stage(threads, m_params.stft_workers, [&]()
+        {
+            PCMJob job;
+            if (!decoded.pop(job))
+            {
+                return false;
+            }
+            auto spectrogram = std::make_unique<siren::Spectrogram>(m_core.make_spectrogram(std::move(job.payload)));
+            if (!job.spectrogram_key.empty())
+            {
+                spectrogram->write(m_core.get_stage_path(job.spectrogram_key), job.spectrogram_key);
+            }
+            transformed.push({job.index, std::move(spectrogram), job.spectrogram_key, job.peak_key});
+            return true;
+        }, [&transformed]() { transformed.close(); });
+
+        spawn_stage(threads, m_params.peak_workers, [&]()
+        {
+            SpectrogramJob job;
+            if (!transformed.pop(job))
+            {
+                return false;
+            }
+            auto peak_spectrogram = std::make_unique<siren::PeakSpectrogram>(m_core.make_peak_spectrogram(std::move(*job.payload)));
+            if (!job.peak_key.empty())
+            {
+                peak_spectrogram->write(m_core.get_stage_path(job.peak_key), job.peak_key);
+            }
+            peaks.push({job.index, std::move(peak_spectrogram), job.spectrogram_key, job.peak_key});
+            return true;
+        }, [&peaks]() { peaks.close(); });
+
+        spawn_stage(threads, m_params.hash_workers, [&]()
+        {
+            PeakJob job;
+            if (!peaks.pop(job))
+            {
+                return false;
+            }
+            deliver(job.index, m_core.make_fingerprint(std::move(*job.payload)));
+            return true;
+        }, []() {});
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    std::vector<CoreReturnType> BatchExecutor::run(const std::vector<std::string>& track_paths) const
+    {
+        std::vector<CoreReturnType> results(track_paths.size());
+        run(track_paths, [&results](size_t index, CoreReturnType&& result)
+        {
+            results[index] = std::move(result);
+        });
+        return results;
+    }
+
+}// namespace siren::pipeline
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../siren.h"
+
+namespace siren::pipeline
+{
+
+    struct PipelineParameters
+    {
+        /**
+        * workers per stage and the capacity of the queues between them, the capacities bound
+        * how many decoded tracks and spectrograms can be in flight at once
+        */
+
+        size_t  decode_workers = 2;
+        size_t  stft_workers = 2;
+        size_t  peak_workers = 1;
+        size_t  hash_workers = 2;
+        size_t  queue_capacity = 4;
+    };
+
+    /**
+    * runs SirenCore's decode -> stft -> peaks -> hash stages for a batch of tracks
+    * on separate worker pools connected by bounded queues, with the core's spectrogram cache
+    * enabled a cached track skips the stages before it and newly made stages are stored
+    */
+    class BatchExecutor
+    {
+    public:
+        using Callback = std::function<void(size_t index, CoreReturnType&& result)>;
+
+        explicit BatchExecutor(const SirenCore& core, PipelineParameters params = {});
+
+        /**
+        * callback is invoked once per track in completion order, never concurrently
+        */
+        void run(const std::vector<std::string>& track_paths, const Callback& callback) const;
+
+        /**
+        * results are returned in the order of track_paths
+        */
+        [[nodiscard]] std::vector<CoreReturnType> run(const std::vector<std::string>& track_paths) const;
+
+    private:
+        const SirenCore& m_core;
+        PipelineParameters m_params;
+    };
+
+}// namespace siren::pipeline
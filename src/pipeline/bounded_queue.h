@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace siren::pipeline
+{
+
+    /**
+    * blocking fifo with a fixed capacity, push waits while the queue is full
+    * which is what propagates backpressure to the stages in front of it
+    */
+    template<typename T>
+    class BoundedQueue
+    {
+    public:
+        explicit BoundedQueue(size_t capacity)
+            : m_capacity(capacity == 0 ? 1 : capacity)
+        {
+        }
+
+        void push(T&& item)
+        {
+            std::unique_lock lock(m_mutex);
+            m_not_full.wait(lock, [this]()
+            {
+                return m_queue.size() < m_capacity;
+            });
+            m_queue.push_back(std::move(item));
+            m_not_empty.notify_one();
+        }
+
+        /**
+        * returns false once the queue is closed and drained
+        */
+        bool pop(T& item)
+        {
+            std::unique_lock lock(m_mutex);
+            m_not_empty.wait(lock, [this]()
+            {
+                return !m_queue.empty() || m_closed;
+            });
+            if (m_queue.empty())
+            {
+                return false;
+            }
+            item = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_not_full.notify_one();
+            return true;
+        }
+
+        void close()
+        {
+            std::lock_guard lock(m_mutex);
+            m_closed = true;
+            m_not_empty.notify_all();
+        }
+
+    private:
+        size_t m_capacity;
+        bool m_closed{false};
+        std::deque<T> m_queue;
+        std::mutex m_mutex;
+        std::condition_variable m_not_full;
+        std::condition_variable m_not_empty;
+    };
+
+}// namespace siren::pipeline
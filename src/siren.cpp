@@ -1,4 +1,8 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include "siren.h"
+#include "common/hash/xxh64.h"
 
 namespace siren
 {
@@ -9,32 +13,263 @@ namespace siren
     {
         release_assert(!s_instance, "Siren core already exists");
         s_instance = this;
+
+        if (m_specification.core_params.pcm_cache_budget > 0)
+        {
+            m_pcm_cache = std::make_unique<siren::audio::PCMCache>(m_specification.core_params.pcm_cache_budget);
+        }
+        if (m_specification.core_params.stft_threads > 1)
+        {
+            m_stft_pool = std::make_unique<siren::ThreadPool>(m_specification.core_params.stft_threads);
+        }
+        if (m_specification.core_params.frequency_scale != FrequencyScale::Linear)
+        {
+            m_filterbank = std::make_unique<siren::Filterbank>(m_specification.core_params.frequency_scale, m_specification.core_params.filter_count,
+                                                               m_specification.core_params.target_window_size, m_specification.core_params.target_sampling_rate);
+        }
+        if (!m_specification.core_params.spectrogram_cache_dir.empty())
+        {
+            // a directory that cannot be created only turns every cache write into a miss
+            std::error_code ec;
+            std::filesystem::create_directories(m_specification.core_params.spectrogram_cache_dir, ec);
+        }
     }
 
-    CoreReturnType SirenCore::make_fingerprint(const std::string& track_path) const
+    CoreReturnType SirenCore::make_fingerprint(const std::string& track_path, const siren::audio::TimeRange& range) const
+    {
+        if (!range.is_valid())
+        {
+            CoreReturnType return_obj;
+            return_obj.code = CoreStatus::CoreParamsLogicError;
+            return return_obj;
+        }
+
+        std::string spectrogram_key;
+        std::string peak_key;
+        if (make_stage_keys(track_path, range, spectrogram_key, peak_key))
+        {
+            return make_cached_fingerprint(track_path, range, spectrogram_key, peak_key);
+        }
+
+        std::unique_ptr<siren::audio::PCM> audio = decode_track(track_path, range);
+        if (!audio)
+        {
+            CoreReturnType return_obj;
+            return_obj.code = CoreStatus::TargetFileDoesNotExist;
+            return return_obj;
+        }
+        return make_fingerprint(std::move(audio));
+    }
+
+    CoreReturnType SirenCore::make_fingerprint(std::shared_ptr<const siren::audio::MappedFile> file, const siren::audio::TimeRange& range) const
     {
         const unsigned int target_sampling_rate = m_specification.core_params.target_sampling_rate;
         const unsigned int target_channel_count = m_specification.core_params.target_channel_count;
-        const size_t target_window_size = m_specification.core_params.target_window_size;
-        const size_t target_block_size = m_specification.core_params.target_block_size;
-        const float target_zscore = m_specification.core_params.target_zscore;
-        const size_t target_band_count = m_specification.core_params.target_band_count;
-        const size_t min_peak_count = m_specification.core_params.min_peak_count;
-        const float stride_coeff = m_specification.core_params.stride_coeff;
-        siren::WindowFunction target_window_function = m_specification.core_params.target_window_function;
 
         CoreReturnType return_obj;
+        if (!range.is_valid())
+        {
+            return_obj.code = CoreStatus::CoreParamsLogicError;
+            return return_obj;
+        }
+        if (!file || !file->is_mapped())
+        {
+            return_obj.code = CoreStatus::TargetFileDoesNotExist;
+            return return_obj;
+        }
 
-        std::unique_ptr<siren::FFT> fft = std::make_unique<siren::KissFFT>(target_window_function, target_window_size);
-        std::unique_ptr<siren::audio::PCM> audio = std::make_unique<siren::audio::PCM>(track_path, target_channel_count, target_sampling_rate);
-
-        if (!audio->config_decoder())
+        std::unique_ptr<siren::audio::PCM> audio = std::make_unique<siren::audio::PCM>(std::move(file), target_channel_count, target_sampling_rate);
+        if (!decode(*audio, range))
         {
             return_obj.code = CoreStatus::TargetFileDoesNotExist;
             return return_obj;
         }
+        return make_fingerprint(std::move(audio));
+    }
+
+    CoreReturnType SirenCore::make_fingerprint(const void* data, size_t size, const siren::audio::TimeRange& range) const
+    {
+        const unsigned int target_sampling_rate = m_specification.core_params.target_sampling_rate;
+        const unsigned int target_channel_count = m_specification.core_params.target_channel_count;
+
+        if (!range.is_valid())
+        {
+            CoreReturnType return_obj;
+            return_obj.code = CoreStatus::CoreParamsLogicError;
+            return return_obj;
+        }
+
+        std::unique_ptr<siren::audio::PCM> audio = std::make_unique<siren::audio::PCM>(data, size, target_channel_count, target_sampling_rate);
+        if (!decode(*audio, range))
+        {
+            CoreReturnType return_obj;
+            return_obj.code = CoreStatus::TargetBufferIsInvalid;
+            return return_obj;
+        }
+        return make_fingerprint(std::move(audio));
+    }
+
+    CoreReturnType SirenCore::make_fingerprint(const int16_t* samples, size_t frame_count, unsigned int channels, unsigned int sampling_rate, const siren::audio::TimeRange& range) const
+    {
+        return make_fingerprint_from_samples(samples, frame_count, channels, sampling_rate, range);
+    }
+
+    CoreReturnType SirenCore::make_fingerprint(const float* samples, size_t frame_count, unsigned int channels, unsigned int sampling_rate, const siren::audio::TimeRange& range) const
+    {
+        return make_fingerprint_from_samples(samples, frame_count, channels, sampling_rate, range);
+    }
+
+    template<typename Sample>
+    CoreReturnType SirenCore::make_fingerprint_from_samples(const Sample* samples, size_t frame_count, unsigned int channels, unsigned int sampling_rate, const siren::audio::TimeRange& range) const
+    {
+        const unsigned int target_sampling_rate = m_specification.core_params.target_sampling_rate;
+        const unsigned int target_channel_count = m_specification.core_params.target_channel_count;
+        const audio::ResamplerQuality resampler_quality = m_specification.core_params.resampler_quality;
+
+        if (!range.is_valid())
+        {
+            CoreReturnType return_obj;
+            return_obj.code = CoreStatus::CoreParamsLogicError;
+            return return_obj;
+        }
+
+        std::unique_ptr<siren::audio::PCM> audio = std::make_unique<siren::audio::PCM>(target_channel_count, target_sampling_rate);
+        audio->set_range(range);
+        audio->set_resampler(resampler_quality);
+
+        if (!audio->config_samples(samples, frame_count, channels, sampling_rate))
+        {
+            CoreReturnType return_obj;
+            return_obj.code = CoreStatus::TargetBufferIsInvalid;
+            return return_obj;
+        }
+        return make_fingerprint(std::move(audio));
+    }
+
+    std::unique_ptr<siren::audio::PCM> SirenCore::decode_track(const std::string& track_path, const siren::audio::TimeRange& range) const
+    {
+        const unsigned int target_sampling_rate = m_specification.core_params.target_sampling_rate;
+        const unsigned int target_channel_count = m_specification.core_params.target_channel_count;
+        const bool mmap_input = m_specification.core_params.mmap_input;
+        const bool stream_decode = m_specification.core_params.stream_decode;
+
+        if (!range.is_valid())
+        {
+            return nullptr;
+        }
+
+        // streamed pcm never holds the whole track, so there is nothing to cache
+        siren::audio::PCMCacheKey cache_key;
+        bool use_cache = m_pcm_cache && !stream_decode && siren::audio::PCMCache::make_key(track_path, cache_key);
+        if (use_cache)
+        {
+            cache_key.sampling_rate = target_sampling_rate;
+            cache_key.channels = target_channel_count;
+            cache_key.range = range;
+            cache_key.builtin_resampler = m_specification.core_params.builtin_resampler;
+            cache_key.resampler_quality = m_specification.core_params.resampler_quality;
+
+            if (auto cached = m_pcm_cache->find(cache_key))
+            {
+                return cached;
+            }
+        }
+
+        std::unique_ptr<siren::audio::PCM> audio;
+        if (mmap_input)
+        {
+            auto file = std::make_shared<siren::audio::MappedFile>(track_path);
+            if (!file->map())
+            {
+                return nullptr;
+            }
+            audio = std::make_unique<siren::audio::PCM>(std::move(file), target_channel_count, target_sampling_rate);
+        }
+        else
+        {
+            audio = std::make_unique<siren::audio::PCM>(track_path, target_channel_count, target_sampling_rate);
+        }
+
+        if (!decode(*audio, range))
+        {
+            return nullptr;
+        }
+        if (use_cache)
+        {
+            m_pcm_cache->insert(cache_key, *audio);
+        }
+        return audio;
+    }
+
+    bool SirenCore::decode(siren::audio::PCM& audio, const siren::audio::TimeRange& range) const
+    {
+        const bool stream_decode = m_specification.core_params.stream_decode;
+        const size_t stream_chunk_size = m_specification.core_params.stream_chunk_size;
+        const bool builtin_resampler = m_specification.core_params.builtin_resampler;
+        const audio::ResamplerQuality resampler_quality = m_specification.core_params.resampler_quality;
+
+        audio.set_range(range);
+        if (builtin_resampler)
+        {
+            audio.set_resampler(resampler_quality);
+        }
+        return stream_decode ? audio.config_stream(stream_chunk_size) : audio.config_decoder();
+    }
+
+    siren::Spectrogram SirenCore::make_spectrogram(std::unique_ptr<siren::audio::PCM> audio) const
+    {
+        const size_t target_window_size = m_specification.core_params.target_window_size;
+        siren::WindowFunction target_window_function = m_specification.core_params.target_window_function;
+        siren::FFTBackend target_fft_backend = m_specification.core_params.target_fft_backend;
+
+        std::unique_ptr<siren::FFT> fft;
+        switch (target_fft_backend)
+        {
+        case FFTBackend::KissComplex:
+            fft = std::make_unique<siren::KissFFT>(target_window_function, target_window_size);
+            break;
+        case FFTBackend::KissReal:
+            fft = std::make_unique<siren::KissFFTR>(target_window_function, target_window_size);
+            break;
+        case FFTBackend::Batched:
+            fft = std::make_unique<siren::BatchFFT>(target_window_function, target_window_size);
+            break;
+        case FFTBackend::FixedPoint:
+            fft = std::make_unique<siren::FixedPointFFT>(target_window_function, target_window_size);
+            break;
+        }
+        siren::Spectrogram spectrogram(std::move(audio), std::move(fft), m_stft_pool.get(), m_specification.core_params.target_hop_size, m_filterbank.get(),
+                                       m_specification.core_params.silence_threshold);
+        if (m_specification.core_params.low_memory)
+        {
+            spectrogram.release_inputs();
+        }
+        return spectrogram;
+    }
+
+    siren::PeakSpectrogram SirenCore::make_peak_spectrogram(siren::Spectrogram&& spectrogram) const
+    {
+        const float target_zscore = m_specification.core_params.target_zscore;
+        const size_t target_band_count = m_specification.core_params.target_band_count;
+        const StatsEngine stats_engine = m_specification.core_params.stats_engine;
+        const PeakDetector peak_detector = m_specification.core_params.peak_detector;
+        const PeakNeighborhood peak_neighborhood = m_specification.core_params.peak_neighborhood;
+
+        siren::PeakSpectrogram peak_spectrogram(std::move(spectrogram), target_zscore, target_band_count, stats_engine, peak_detector, peak_neighborhood, m_stft_pool.get());
+        if (m_specification.core_params.low_memory)
+        {
+            peak_spectrogram.release_magnitudes();
+        }
+        return peak_spectrogram;
+    }
 
-        siren::PeakSpectrogram spectrogram(std::move(audio), std::move(fft), target_zscore, target_band_count);
+    CoreReturnType SirenCore::make_fingerprint(siren::PeakSpectrogram&& spectrogram) const
+    {
+        const size_t target_block_size = m_specification.core_params.target_block_size;
+        const size_t min_peak_count = m_specification.core_params.min_peak_count;
+        const float stride_coeff = m_specification.core_params.stride_coeff;
+
+        CoreReturnType return_obj;
         siren::Fingerprint fingerprint;
 
         CoreStatus code = fingerprint.make_fingerprint(std::move(spectrogram), target_block_size, min_peak_count, stride_coeff);
@@ -43,4 +278,82 @@ namespace siren
 
         return return_obj;
     }
-}// namespace siren
\ No newline at end of file
+
+    CoreReturnType SirenCore::make_cached_fingerprint(const std::string& track_path, const siren::audio::TimeRange& range,
+                                                      const std::string& spectrogram_key, const std::string& peak_key) const
+    {
+        // peaks only change with the peak parameters, the spectrogram with the stft ones, so a sweep
+        // over the hashing parameters starts from the peaks and one over the peak parameters from the spectrogram
+        const std::string peak_path = get_stage_path(peak_key);
+        if (auto peak_spectrogram = siren::PeakSpectrogram::load(peak_path, peak_key))
+        {
+            return make_fingerprint(std::move(*peak_spectrogram));
+        }
+
+        const std::string spectrogram_path = get_stage_path(spectrogram_key);
+        std::unique_ptr<siren::Spectrogram> spectrogram = siren::Spectrogram::load(spectrogram_path, spectrogram_key);
+        if (!spectrogram)
+        {
+            std::unique_ptr<siren::audio::PCM> audio = decode_track(track_path, range);
+            if (!audio)
+            {
+                CoreReturnType return_obj;
+                return_obj.code = CoreStatus::TargetFileDoesNotExist;
+                return return_obj;
+            }
+            spectrogram = std::make_unique<siren::Spectrogram>(make_spectrogram(std::move(audio)));
+            spectrogram->write(spectrogram_path, spectrogram_key);
+        }
+
+        siren::PeakSpectrogram peak_spectrogram = make_peak_spectrogram(std::move(*spectrogram));
+        peak_spectrogram.write(peak_path, peak_key);
+        return make_fingerprint(std::move(peak_spectrogram));
+    }
+
+    bool SirenCore::make_stage_keys(const std::string& track_path, const siren::audio::TimeRange& range, std::string& spectrogram_key, std::string& peak_key) const
+    {
+        const CoreParameters& params = m_specification.core_params;
+
+        siren::audio::PCMCacheKey source_key;
+        if (params.spectrogram_cache_dir.empty() || !siren::audio::PCMCache::make_key(track_path, source_key))
+        {
+            return false;
+        }
+        source_key.sampling_rate = params.target_sampling_rate;
+        source_key.channels = params.target_channel_count;
+        source_key.range = range;
+        source_key.builtin_resampler = params.builtin_resampler;
+        source_key.resampler_quality = params.resampler_quality;
+
+        // floats are keyed by their bits, a decimal rendering would merge nearby values
+        auto float_bits = [](float value)
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return std::to_string(bits);
+        };
+
+        spectrogram_key = source_key.to_str() + '|' + std::to_string(params.target_window_size) + '|' + std::to_string(params.target_hop_size) + '|'
+                          + std::to_string((int)params.target_window_function) + '|' + std::to_string((int)params.target_fft_backend) + '|'
+                          + std::to_string((int)params.frequency_scale) + '|'
+                          + (params.frequency_scale != FrequencyScale::Linear ? std::to_string(params.filter_count) : "-") + '|'
+                          + float_bits(params.silence_threshold);
+        peak_key = spectrogram_key + '|' + float_bits(params.target_zscore) + '|' + std::to_string(params.target_band_count) + '|'
+                   + std::to_string((int)params.stats_engine) + '|' + std::to_string((int)params.peak_detector) + '|'
+                   + std::to_string(params.peak_neighborhood.frames) + '|' + std::to_string(params.peak_neighborhood.bins);
+        return true;
+    }
+
+    std::string SirenCore::get_stage_path(const std::string& key) const
+    {
+        // the full key is stored in the file and compared on load, a hash collision is only a miss
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.spec", (unsigned long long)xxh64::hash(key.data(), key.size(), 0));
+        return (std::filesystem::path(m_specification.core_params.spectrogram_cache_dir) / name).string();
+    }
+
+    CoreReturnType SirenCore::make_fingerprint(std::unique_ptr<siren::audio::PCM> audio) const
+    {
+        return make_fingerprint(make_peak_spectrogram(make_spectrogram(std::move(audio))));
+    }
+}// namespace siren
@@ -2,11 +2,18 @@
 
 #include <iostream>
 #include <memory>
+#include <string>
 
 #include "decoder/pcm.h"
+#include "decoder/pcm_cache.h"
 #include "fft/fft.h"
+#include "fft/batch_fft.h"
+#include "fft/fixed_fft.h"
+#include "fft/filterbank.h"
 #include "entities/fingerprint.h"
 #include "entities/spectrogram.h"
+#include "entities/streaming_spectrogram.h"
+#include "common/thread_pool.h"
 
 namespace siren
 {
@@ -20,12 +27,33 @@ namespace siren
         unsigned int    target_sampling_rate = 11025;
         unsigned int    target_channel_count = 1;
         size_t          target_window_size = 1024;
+        FrequencyScale  frequency_scale = FrequencyScale::Linear; // Log or Mel aggregate the bins into filter_count filters
+        size_t          filter_count = 64;
+        size_t          target_hop_size = 0; // 0 keeps the legacy framing
+        float           silence_threshold = 0; // rms below which a window is skipped, 0.001 is -60 dBFS, 0 disables the gate
         float           target_zscore = 3; // 2.45 for client-side fingerprinting
         size_t          target_band_count = 15;
+        StatsEngine     stats_engine = StatsEngine::Select; // Sort reproduces the original full sort
+        PeakDetector    peak_detector = PeakDetector::ZScore; // LocalMaximum keeps fewer peaks, lower min_peak_count with it
+        PeakNeighborhood peak_neighborhood{};
         float           stride_coeff = 0.5; // 0.2 for client-side fingerprinting
         size_t          min_peak_count = 350;
         size_t          target_block_size = 455;
         WindowFunction  target_window_function = WindowFunction::Hanning;
+#ifdef SIREN_FIXED_POINT
+        FFTBackend      target_fft_backend = FFTBackend::FixedPoint; // shares ~97-99% of hashes with the float path
+#else
+        FFTBackend      target_fft_backend = FFTBackend::KissComplex;
+#endif
+        bool            stream_decode = false;
+        size_t          stream_chunk_size = 65536;
+        bool            mmap_input = false;
+        bool            builtin_resampler = false;
+        audio::ResamplerQuality resampler_quality = audio::ResamplerQuality::Medium;
+        size_t          pcm_cache_budget = 0; // 0 disables the cache
+        std::string     spectrogram_cache_dir; // empty disables the cache
+        bool            low_memory = false; // pair with stream_decode to never hold the whole track
+        size_t          stft_threads = 0; // 0 and 1 keep the stft of a track on the calling thread
     };
 
     struct CoreSpecification
@@ -43,7 +71,7 @@ namespace siren
         }
 
         Fingerprint<> fingerprint{};
-        CoreStatus code;
+        CoreStatus code = CoreStatus::CoreParamsFatalError; // results that were never filled in read as failures
     };
 
     class SirenCore
@@ -56,14 +84,64 @@ namespace siren
             return *s_instance;
         }
 
-        [[nodiscard]] CoreReturnType make_fingerprint(const std::string& track_path) const;
+        /**
+        * a non-default range fingerprints only [start_ms, end_ms) of the track,
+        * fingerprint timestamps stay relative to the start of the whole track,
+        * every overload returns CoreParamsLogicError for a range that ends before it starts
+        */
+        [[nodiscard]] CoreReturnType make_fingerprint(const std::string& track_path, const siren::audio::TimeRange& range = {}) const;
+
+        /**
+        * fingerprints an encoded track that is already in memory (e.g. a request body),
+        * the buffer stays owned by the caller and is not copied
+        */
+        [[nodiscard]] CoreReturnType make_fingerprint(const void* data, size_t size, const siren::audio::TimeRange& range = {}) const;
+
+        /**
+        * fingerprints an already mapped track, the same mapping can be shared between calls
+        */
+        [[nodiscard]] CoreReturnType make_fingerprint(std::shared_ptr<const siren::audio::MappedFile> file, const siren::audio::TimeRange& range = {}) const;
+
+        /**
+        * fingerprints raw interleaved pcm (e.g. from a live capture), skipping container and codec
+        * entirely, samples are downmixed and resampled to the core's target format
+        */
+        [[nodiscard]] CoreReturnType make_fingerprint(const int16_t* samples, size_t frame_count, unsigned int channels, unsigned int sampling_rate, const siren::audio::TimeRange& range = {}) const;
+        [[nodiscard]] CoreReturnType make_fingerprint(const float* samples, size_t frame_count, unsigned int channels, unsigned int sampling_rate, const siren::audio::TimeRange& range = {}) const;
+
+        /**
+        * individual stages of make_fingerprint, used by pipeline::BatchExecutor to run them on separate workers,
+        * decode_track returns nullptr when the track cannot be decoded or the range is invalid
+        */
+        [[nodiscard]] std::unique_ptr<siren::audio::PCM> decode_track(const std::string& track_path, const siren::audio::TimeRange& range = {}) const;
+        [[nodiscard]] siren::Spectrogram make_spectrogram(std::unique_ptr<siren::audio::PCM> audio) const;
+        [[nodiscard]] siren::PeakSpectrogram make_peak_spectrogram(siren::Spectrogram&& spectrogram) const;
+        [[nodiscard]] CoreReturnType make_fingerprint(siren::PeakSpectrogram&& spectrogram) const;
+
+        /**
+        * cache keys of the spectrogram and peak stages of a track file, false when the cache is disabled or the file cannot be stat'ed,
+        * get_stage_path is where a stage stored under key lives. BatchExecutor uses them to skip the stages make_fingerprint would skip
+        */
+        bool make_stage_keys(const std::string& track_path, const siren::audio::TimeRange& range, std::string& spectrogram_key, std::string& peak_key) const;
+        [[nodiscard]] std::string get_stage_path(const std::string& key) const;
+
+    private:
+        template<typename Sample>
+        [[nodiscard]] CoreReturnType make_fingerprint_from_samples(const Sample* samples, size_t frame_count, unsigned int channels, unsigned int sampling_rate, const siren::audio::TimeRange& range) const;
+        [[nodiscard]] CoreReturnType make_fingerprint(std::unique_ptr<siren::audio::PCM> audio) const;
+        bool decode(siren::audio::PCM& audio, const siren::audio::TimeRange& range) const;
+        [[nodiscard]] CoreReturnType make_cached_fingerprint(const std::string& track_path, const siren::audio::TimeRange& range,
+                                                             const std::string& spectrogram_key, const std::string& peak_key) const;
 
     private:
         CoreSpecification m_specification;
+        std::unique_ptr<siren::audio::PCMCache> m_pcm_cache;
+        std::unique_ptr<siren::ThreadPool> m_stft_pool;
+        std::unique_ptr<siren::Filterbank> m_filterbank;
 
     private:
         static SirenCore* s_instance;
     };
 
     SirenCore* CreateCore();
-}// namespace siren
\ No newline at end of file
+}// namespace siren
@@ -1,9 +1,102 @@
 #include "common.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <unordered_set>
 #include <gtest/gtest.h>
 
+namespace
+{
+    // share of the hashes of lhs that also occur in rhs
+    float hash_overlap(const siren::Fingerprint<>& lhs, const siren::Fingerprint<>& rhs)
+    {
+        const auto hashes = rhs.get_hashes();
+        const std::unordered_set<uint64_t> known(hashes.cbegin(), hashes.cend());
+        size_t shared = 0;
+        for (auto it = lhs.cbegin(); it != lhs.cend(); ++it)
+        {
+            shared += known.count(it->first);
+        }
+        return lhs.get_size() == 0 ? 0.0f : static_cast<float>(shared) / static_cast<float>(lhs.get_size());
+    }
+}
+
 TEST(CoreTest, DefaultParams)
 {
     auto core = test_common::CommonCore::GetCore();
     auto fingerprint = core->make_fingerprint("../audio/jazzfrom5to7.wav");
     EXPECT_EQ(fingerprint.code, siren::CoreStatus::OK);
-}
\ No newline at end of file
+}
+
+TEST(CoreTest, MemoryBuffer)
+{
+    std::ifstream file("../audio/jazzfrom5to7.wav", std::ios::binary);
+    std::vector<char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    auto core = test_common::CommonCore::GetCore();
+    auto from_path = core->make_fingerprint("../audio/jazzfrom5to7.wav");
+    auto from_memory = core->make_fingerprint(buffer.data(), buffer.size());
+    EXPECT_EQ(from_memory.code, siren::CoreStatus::OK);
+    EXPECT_EQ(from_memory.fingerprint, from_path.fingerprint);
+
+    auto invalid = core->make_fingerprint(buffer.data(), 16);
+    EXPECT_EQ(invalid.code, siren::CoreStatus::TargetBufferIsInvalid);
+}
+
+TEST(CoreTest, TimeRange)
+{
+    auto core = test_common::CommonCore::GetCore();
+    auto fingerprint = core->make_fingerprint("../audio/jazzfrom5to7.wav", siren::audio::TimeRange{800, 0});
+    EXPECT_EQ(fingerprint.code, siren::CoreStatus::OK);
+    for (auto it = fingerprint.fingerprint.cbegin(); it != fingerprint.fingerprint.cend(); ++it)
+    {
+        EXPECT_GE(it->second, 800);
+    }
+}
+
+TEST(CoreTest, InvalidTimeRange)
+{
+    std::ifstream file("../audio/jazzfrom5to7.wav", std::ios::binary);
+    std::vector<char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::vector<float> samples(11025);
+
+    auto core = test_common::CommonCore::GetCore();
+    const siren::audio::TimeRange reversed{1500, 500};
+    EXPECT_EQ(core->make_fingerprint("../audio/jazzfrom5to7.wav", reversed).code, siren::CoreStatus::CoreParamsLogicError);
+    EXPECT_EQ(core->make_fingerprint(buffer.data(), buffer.size(), reversed).code, siren::CoreStatus::CoreParamsLogicError);
+    EXPECT_EQ(core->make_fingerprint(samples.data(), samples.size(), 1, 11025, reversed).code, siren::CoreStatus::CoreParamsLogicError);
+    EXPECT_EQ(core->make_fingerprint("../audio/jazzfrom5to7.wav", siren::audio::TimeRange{500, 500}).code, siren::CoreStatus::CoreParamsLogicError);
+    EXPECT_EQ(core->decode_track("../audio/jazzfrom5to7.wav", reversed), nullptr);
+}
+
+TEST(CoreTest, RawSamples)
+{
+    siren::audio::PCM audio("../audio/jazzfrom5to7.wav", 1, 11025);
+    EXPECT_TRUE(audio.config_decoder());
+
+    const float* mono = audio.get_frames(0, audio.get_frame_count());
+    std::vector<int16_t> stereo;
+    for (size_t i = 0; i < audio.get_frame_count(); i++)
+    {
+        const auto sample = static_cast<int16_t>(std::clamp(std::lround(mono[i] * 32767.0f), -32768L, 32767L));
+        stereo.push_back(sample);
+        stereo.push_back(sample);
+    }
+
+    // int16 quantisation and resampling move a few peaks, so most but not all hashes survive
+    constexpr float min_quantised_overlap = 0.95f;
+    constexpr float min_resampled_overlap = 0.75f;
+
+    auto core = test_common::CommonCore::GetCore();
+    auto from_path = core->make_fingerprint("../audio/jazzfrom5to7.wav");
+    auto from_samples = core->make_fingerprint(stereo.data(), audio.get_frame_count(), 2, 11025);
+    EXPECT_EQ(from_samples.code, siren::CoreStatus::OK);
+    EXPECT_GE(hash_overlap(from_samples.fingerprint, from_path.fingerprint), min_quantised_overlap);
+
+    siren::audio::PCM upsampled("../audio/jazzfrom5to7.wav", 1, 22050);
+    EXPECT_TRUE(upsampled.config_decoder());
+    auto resampled = core->make_fingerprint(upsampled.get_frames(0, upsampled.get_frame_count()), upsampled.get_frame_count(), 1, 22050);
+    EXPECT_EQ(resampled.code, siren::CoreStatus::OK);
+    EXPECT_GE(hash_overlap(resampled.fingerprint, from_path.fingerprint), min_resampled_overlap);
+}
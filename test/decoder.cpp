@@ -1,7 +1,9 @@
 #include <iostream>
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <cmath>
 #include "../src/decoder/pcm.h"
+#include "../src/decoder/pcm_cache.h"
 
 TEST(DecoderTest, TrivialTrue)
 {
@@ -28,4 +30,118 @@ TEST(DecoderTest, CorrectnessCheck)
     EXPECT_EQ(audio.get_sampling_rate(), 11025);
     EXPECT_EQ(audio.get_frame_count(), std::ceil(audio.get_sampling_rate() * (audio.get_length_in_ms() / 1000)));
     EXPECT_EQ((size_t)audio.get_length_in_ms(), 2025);
-}
\ No newline at end of file
+}
+TEST(DecoderTest, StreamMatchesFullDecode)
+{
+    std::string test_path = "../audio/jazzfrom5to7.wav";
+    siren::audio::PCM audio(test_path, 1, 11025);
+    siren::audio::PCM stream(test_path, 1, 11025);
+
+    EXPECT_TRUE(audio.config_decoder());
+    EXPECT_TRUE(stream.config_stream(1000));
+    EXPECT_TRUE(stream.is_streaming());
+    EXPECT_EQ(audio.get_frame_count(), stream.get_frame_count());
+
+    const size_t window_size = 1024;
+    for (size_t offset = 0; offset + window_size <= audio.get_frame_count(); offset += window_size / 2)
+    {
+        const float* expected = audio.get_frames(offset, window_size);
+        const float* actual = stream.get_frames(offset, window_size);
+        EXPECT_TRUE(std::equal(expected, expected + window_size, actual));
+    }
+}
+
+TEST(DecoderTest, SharedMapping)
+{
+    auto file = std::make_shared<siren::audio::MappedFile>("../audio/jazzfrom5to7.wav");
+    EXPECT_TRUE(file->map());
+
+    siren::audio::PCM audio("../audio/jazzfrom5to7.wav", 1, 11025);
+    siren::audio::PCM mapped(file, 1, 11025);
+    siren::audio::PCM resampled(file, 1, 8000);
+
+    EXPECT_TRUE(audio.config_decoder());
+    EXPECT_TRUE(mapped.config_decoder());
+    EXPECT_TRUE(resampled.config_decoder());
+    EXPECT_EQ(mapped.get_frame_count(), audio.get_frame_count());
+    EXPECT_EQ(resampled.get_sampling_rate(), 8000);
+
+    const float* expected = audio.get_frames(0, audio.get_frame_count());
+    const float* actual = mapped.get_frames(0, mapped.get_frame_count());
+    EXPECT_TRUE(std::equal(expected, expected + audio.get_frame_count(), actual));
+
+    EXPECT_FALSE(siren::audio::MappedFile("../audio/none.wav").map());
+}
+
+TEST(DecoderTest, TimeRange)
+{
+    std::string test_path = "../audio/jazzfrom5to7.wav";
+    siren::audio::PCM audio(test_path, 1, 11025);
+    siren::audio::PCM range(test_path, 1, 11025);
+    range.set_range({500, 1500});
+
+    EXPECT_TRUE(audio.config_decoder());
+    EXPECT_TRUE(range.config_decoder());
+    EXPECT_EQ(range.get_offset_in_ms(), 500);
+    EXPECT_EQ(range.get_frame_count(), 11025);
+    EXPECT_EQ((size_t)range.get_length_in_ms(), 1000);
+
+    const float* expected = audio.get_frames(11025 / 2, range.get_frame_count());
+    const float* actual = range.get_frames(0, range.get_frame_count());
+    EXPECT_TRUE(std::equal(actual, actual + range.get_frame_count(), expected));
+
+    siren::audio::PCM out_of_bounds(test_path, 1, 11025);
+    out_of_bounds.set_range({5000, 6000});
+    EXPECT_FALSE(out_of_bounds.config_decoder());
+}
+
+TEST(DecoderTest, BuiltinResampler)
+{
+    std::string test_path = "../audio/jazzfrom5to7.wav";
+    siren::audio::PCM audio(test_path, 1, 5512);
+    siren::audio::PCM stream(test_path, 1, 5512);
+    audio.set_resampler(siren::audio::ResamplerQuality::Fast);
+    stream.set_resampler(siren::audio::ResamplerQuality::Fast);
+
+    EXPECT_TRUE(audio.config_decoder());
+    EXPECT_TRUE(stream.config_stream(1000));
+    EXPECT_EQ(audio.get_sampling_rate(), 5512);
+    EXPECT_EQ(audio.get_frame_count(), stream.get_frame_count());
+
+    const float* expected = audio.get_frames(0, audio.get_frame_count());
+    const float* actual = stream.get_frames(0, stream.get_frame_count());
+    EXPECT_TRUE(std::equal(expected, expected + audio.get_frame_count(), actual));
+}
+
+TEST(DecoderTest, PCMCache)
+{
+    std::string test_path = "../audio/jazzfrom5to7.wav";
+    siren::audio::PCM audio(test_path, 1, 11025);
+    EXPECT_TRUE(audio.config_decoder());
+
+    siren::audio::PCMCacheKey key;
+    EXPECT_TRUE(siren::audio::PCMCache::make_key(test_path, key));
+    EXPECT_FALSE(siren::audio::PCMCache::make_key("../audio/none.wav", key));
+    key.sampling_rate = 11025;
+    key.channels = 1;
+
+    const size_t track_bytes = audio.get_frame_count() * sizeof(float);
+    siren::audio::PCMCache cache(track_bytes);
+    EXPECT_EQ(cache.find(key), nullptr);
+
+    cache.insert(key, audio);
+    auto cached = cache.find(key);
+    ASSERT_NE(cached, nullptr);
+    EXPECT_EQ(cached->get_samples(), audio.get_samples());
+    EXPECT_EQ(cached->get_frame_count(), audio.get_frame_count());
+    EXPECT_EQ(cached->get_length_in_ms(), audio.get_length_in_ms());
+
+    siren::audio::PCMCacheKey other = key;
+    other.sampling_rate = 8000;
+    EXPECT_EQ(cache.find(other), nullptr);
+
+    cache.insert(other, audio);
+    EXPECT_EQ(cache.get_entry_count(), 1);
+    EXPECT_EQ(cache.get_size_in_bytes(), track_bytes);
+    EXPECT_EQ(cache.find(key), nullptr);
+}
@@ -1,7 +1,12 @@
+#include <filesystem>
 #include <iostream>
 #include <gtest/gtest.h>
 #include "../src/entities/spectrogram.h"
 #include "../src/entities/fingerprint.h"
+#include "../src/entities/streaming_spectrogram.h"
+#include "../src/fft/batch_fft.h"
+#include "../src/fft/plan_cache.h"
+#include "../src/common/simd.h"
 
 siren::PeakSpectrogram init_spectrogram(const std::string& audio_path, int sampling_rate, int window_size, int channel_count)
 {
@@ -25,6 +30,490 @@ TEST(Spectrogram, Trivial)
     EXPECT_EQ(spectrogram.rows(), floor(sampling_rate/2));
 }
 
+TEST(Spectrogram, ParallelMatchesSerial)
+{
+    const std::string path = "../audio/jazzfrom5to7.wav";
+    const size_t window_size = 1024;
+
+    auto make_spectrogram = [&](siren::ThreadPool* thread_pool)
+    {
+        auto audio = std::make_unique<siren::audio::PCM>(path, 1, 11025);
+        EXPECT_TRUE(audio->config_decoder());
+        auto fft = std::make_unique<siren::KissFFT>(siren::WindowFunction::Hanning, window_size);
+        return siren::Spectrogram(std::move(audio), std::move(fft), thread_pool);
+    };
+
+    siren::ThreadPool thread_pool(4);
+    siren::Spectrogram serial = make_spectrogram(nullptr);
+    siren::Spectrogram parallel = make_spectrogram(&thread_pool);
+
+    EXPECT_EQ(serial.get_frame_count(), parallel.get_frame_count());
+    EXPECT_EQ(serial.get_magnitudes(), parallel.get_magnitudes());
+
+    for (auto detector : {siren::PeakDetector::ZScore, siren::PeakDetector::LocalMaximum})
+    {
+        siren::PeakSpectrogram serial_peaks(make_spectrogram(nullptr), 3, 15, siren::StatsEngine::Select, detector);
+        siren::PeakSpectrogram parallel_peaks(make_spectrogram(nullptr), 3, 15, siren::StatsEngine::Select, detector, {}, &thread_pool);
+        EXPECT_EQ(serial_peaks.get_occupied_indices(), parallel_peaks.get_occupied_indices());
+    }
+}
+
+TEST(Spectrogram, HopSize)
+{
+    const std::string path = "../audio/jazzfrom5to7.wav";
+    const size_t window_size = 1024;
+    const size_t hop_size = 256;
+
+    auto make_spectrogram = [&](bool stream)
+    {
+        auto audio = std::make_unique<siren::audio::PCM>(path, 1, 11025);
+        EXPECT_TRUE(stream ? audio->config_stream(4096) : audio->config_decoder());
+        auto fft = std::make_unique<siren::KissFFT>(siren::WindowFunction::Hanning, window_size);
+        return siren::Spectrogram(std::move(audio), std::move(fft), nullptr, hop_size);
+    };
+
+    siren::Spectrogram decoded = make_spectrogram(false);
+    siren::Spectrogram streamed = make_spectrogram(true);
+
+    auto audio = std::make_unique<siren::audio::PCM>(path, 1, 11025);
+    EXPECT_TRUE(audio->config_decoder());
+    size_t frame_count = audio->get_frame_count();
+
+    EXPECT_EQ(decoded.get_hop_size(), hop_size);
+    EXPECT_EQ(decoded.get_frame_count(), (frame_count - window_size) / hop_size + 1);
+    EXPECT_EQ(decoded.get_frame_timestamp(0), floor(decoded.get_time_resolution() * window_size / 2));
+    for (size_t f_idx = 1; f_idx < decoded.get_frame_count(); f_idx++)
+    {
+        EXPECT_GT(decoded.get_frame_timestamp(f_idx), decoded.get_frame_timestamp(f_idx - 1));
+    }
+    EXPECT_LT(decoded.get_frame_timestamp(decoded.get_frame_count() - 1), decoded.cols());
+    EXPECT_EQ(decoded.get_magnitudes(), streamed.get_magnitudes());
+}
+
+TEST(Spectrogram, ShortInput)
+{
+    const size_t window_size = 1024;
+    std::vector<float> samples(window_size / 4, 0.5f);
+
+    for (size_t hop_size : {size_t{0}, size_t{256}})
+    {
+        auto audio = std::make_unique<siren::audio::PCM>(1, 11025);
+        EXPECT_TRUE(audio->config_samples(samples.data(), samples.size(), 1, 11025));
+        auto fft = std::make_unique<siren::KissFFT>(siren::WindowFunction::Hanning, window_size);
+        siren::Spectrogram spectrogram(std::move(audio), std::move(fft), nullptr, hop_size);
+        EXPECT_EQ(spectrogram.get_frame_count(), 0);
+    }
+}
+
+TEST(Spectrogram, DenseLayoutMatchesSparse)
+{
+    auto audio = std::make_unique<siren::audio::PCM>("../audio/jazzfrom5to7.wav", 1, 11025);
+    EXPECT_TRUE(audio->config_decoder());
+    auto fft = std::make_unique<siren::KissFFT>(siren::WindowFunction::Hanning, 1024);
+    siren::Spectrogram spectrogram(std::move(audio), std::move(fft));
+
+    EXPECT_EQ(spectrogram.get_magnitudes().size(), spectrogram.get_frame_count() * spectrogram.get_bin_count());
+    EXPECT_LT(spectrogram.get_bin_frequency(spectrogram.get_bin_count() - 1), spectrogram.rows());
+    EXPECT_LT(spectrogram.get_frame_timestamp(spectrogram.get_frame_count() - 1), spectrogram.cols());
+
+    auto sparse = spectrogram.make_sparse_spectrogram();
+    size_t frame_idx = spectrogram.get_frame_count() / 2;
+    for (size_t b_idx = 0; b_idx < spectrogram.get_bin_count(); b_idx++)
+    {
+        float expected = spectrogram.get_frame(frame_idx)[b_idx];
+        EXPECT_EQ(sparse.coeff(spectrogram.get_bin_frequency(b_idx), spectrogram.get_frame_timestamp(frame_idx)), expected);
+    }
+}
+
+TEST(Spectrogram, StreamingPeaksIndependentOfChunking)
+{
+    auto audio = std::make_unique<siren::audio::PCM>("../audio/jazzfrom5to7.wav", 1, 11025);
+    EXPECT_TRUE(audio->config_decoder());
+    const float* samples = audio->get_frames(0, audio->get_frame_count());
+    const size_t frame_count = audio->get_frame_count();
+
+    auto run = [&](size_t chunk_size)
+    {
+        siren::StreamingPeakSpectrogram stream(std::make_unique<siren::KissFFT>(siren::WindowFunction::Hanning, 1024), 11025, 512, 3, 15, 16, 4);
+        std::vector<siren::StreamPeak> peaks;
+        stream.push(samples, chunk_size, peaks);
+        const size_t memory_usage = stream.get_memory_usage();
+        for (size_t offset = chunk_size; offset < frame_count; offset += chunk_size)
+        {
+            stream.push(samples + offset, std::min(chunk_size, frame_count - offset), peaks);
+            EXPECT_EQ(stream.get_memory_usage(), memory_usage);
+        }
+        stream.flush(peaks);
+        EXPECT_EQ(stream.get_frame_count(), (frame_count - 1024) / 512 + 1);
+        return peaks;
+    };
+
+    auto whole = run(frame_count);
+    auto chunked = run(700);
+
+    ASSERT_FALSE(whole.empty());
+    ASSERT_EQ(whole.size(), chunked.size());
+    for (size_t i = 0; i < whole.size(); i++)
+    {
+        EXPECT_EQ(whole[i].frequency, chunked[i].frequency);
+        EXPECT_EQ(whole[i].timestamp, chunked[i].timestamp);
+        EXPECT_LT(whole[i].frequency, 11025 / 2);
+        if (i > 0)
+        {
+            EXPECT_GE(whole[i].timestamp, whole[i - 1].timestamp);
+        }
+    }
+}
+
+TEST(Spectrogram, StatsEnginesAgree)
+{
+    std::vector<float> values(1001);
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        values[i] = static_cast<float>((i * 7919) % 1009) / 17.0f;
+    }
+    for (size_t size : {1, 2, 10, 1000, 1001})
+    {
+        std::vector<float> dist(values.begin(), values.begin() + size);
+        double median = siren::get_median(dist);
+        double mad = siren::get_mad(dist, median);
+
+        std::vector<double> deviations;
+        EXPECT_EQ(siren::select_median(dist), median);
+        EXPECT_EQ(siren::select_mad(dist, median, deviations), mad);
+    }
+
+    for (bool fixed_point : {false, true})
+    {
+        auto make_peaks = [&](siren::StatsEngine engine)
+        {
+            auto audio = std::make_unique<siren::audio::PCM>("../audio/jazzfrom5to7.wav", 1, 11025);
+            EXPECT_TRUE(audio->config_decoder());
+            std::unique_ptr<siren::FFT> fft;
+            if (fixed_point)
+            {
+                fft = std::make_unique<siren::FixedPointFFT>(siren::WindowFunction::Hanning, 1024);
+            }
+            else
+            {
+                fft = std::make_unique<siren::KissFFT>(siren::WindowFunction::Hanning, 1024);
+            }
+            return siren::PeakSpectrogram(std::move(audio), std::move(fft), 3, 15, engine);
+        };
+
+        auto sorted = make_peaks(siren::StatsEngine::Sort);
+        auto selected = make_peaks(siren::StatsEngine::Select);
+        EXPECT_GT(sorted.get_peak_spec_view().nonZeros(), 0);
+        EXPECT_EQ(sorted.get_occupied_indices(), selected.get_occupied_indices());
+    }
+}
+
+TEST(Spectrogram, MaxFilterMatchesBruteForce)
+{
+    const size_t frames = 23;
+    const size_t bins = 37;
+    std::vector<float> input(frames * bins);
+    for (size_t i = 0; i < input.size(); i++)
+    {
+        input[i] = static_cast<float>((i * 7919) % 211);
+    }
+
+    siren::MaxFilter2D filter;
+    std::vector<float> output(input.size());
+    std::vector<int32_t> fixed_input(input.begin(), input.end()), fixed_output(input.size());
+    for (auto [frame_radius, bin_radius] : std::vector<std::pair<size_t, size_t>>{{0, 0}, {1, 3}, {2, 8}, {30, 1}, {4, 50}})
+    {
+        filter.apply(input.data(), frames, bins, frame_radius, bin_radius, output.data());
+        filter.apply(fixed_input.data(), frames, bins, frame_radius, bin_radius, fixed_output.data());
+        for (size_t f = 0; f < frames; f++)
+        {
+            for (size_t b = 0; b < bins; b++)
+            {
+                float expected = input[f * bins + b];
+                for (size_t nf = f > frame_radius ? f - frame_radius : 0; nf <= std::min(frames - 1, f + frame_radius); nf++)
+                {
+                    for (size_t nb = b > bin_radius ? b - bin_radius : 0; nb <= std::min(bins - 1, b + bin_radius); nb++)
+                    {
+                        expected = std::max(expected, input[nf * bins + nb]);
+                    }
+                }
+                ASSERT_EQ(output[f * bins + b], expected);
+                ASSERT_EQ(fixed_output[f * bins + b], expected);
+            }
+        }
+    }
+
+    auto make_peaks = [&](siren::PeakDetector detector)
+    {
+        auto audio = std::make_unique<siren::audio::PCM>("../audio/jazzfrom5to7.wav", 1, 11025);
+        EXPECT_TRUE(audio->config_decoder());
+        auto fft = std::make_unique<siren::KissFFT>(siren::WindowFunction::Hanning, 1024);
+        return siren::PeakSpectrogram(std::move(audio), std::move(fft), 3, 15, siren::StatsEngine::Select, detector);
+    };
+    auto zscore_peaks = make_peaks(siren::PeakDetector::ZScore).get_occupied_indices();
+    auto local_peaks = make_peaks(siren::PeakDetector::LocalMaximum).get_occupied_indices();
+    EXPECT_GT(local_peaks.size(), 0);
+    EXPECT_LT(local_peaks.size(), zscore_peaks.size());
+    EXPECT_TRUE(std::includes(zscore_peaks.begin(), zscore_peaks.end(), local_peaks.begin(), local_peaks.end()));
+}
+
+TEST(Spectrogram, ReleaseIntermediates)
+{
+    auto make_peaks = [](bool low_memory)
+    {
+        auto audio = std::make_unique<siren::audio::PCM>("../audio/jazzfrom5to7.wav", 1, 11025);
+        EXPECT_TRUE(audio->config_stream(4096));
+        auto fft = std::make_unique<siren::KissFFT>(siren::WindowFunction::Hanning, 1024);
+        siren::Spectrogram spectrogram(std::move(audio), std::move(fft));
+        if (low_memory)
+        {
+            spectrogram.release_inputs();
+        }
+        siren::PeakSpectrogram peaks(std::move(spectrogram));
+        if (low_memory)
+        {
+            peaks.release_magnitudes();
+        }
+        return peaks;
+    };
+
+    auto peaks = make_peaks(false);
+    auto low_memory_peaks = make_peaks(true);
+    EXPECT_TRUE(peaks.has_magnitudes());
+    EXPECT_FALSE(low_memory_peaks.has_magnitudes());
+    EXPECT_LT(low_memory_peaks.get_memory_usage(), peaks.get_memory_usage() / 10);
+
+    siren::Fingerprint fingerprint, low_memory_fingerprint;
+    EXPECT_EQ(fingerprint.make_fingerprint(peaks, 455, 350, 0.5), siren::CoreStatus::OK);
+    EXPECT_EQ(low_memory_fingerprint.make_fingerprint(low_memory_peaks, 455, 350, 0.5), siren::CoreStatus::OK);
+    EXPECT_EQ(fingerprint, low_memory_fingerprint);
+}
+
+TEST(Spectrogram, CacheRoundTrip)
+{
+    auto audio = std::make_unique<siren::audio::PCM>("../audio/jazzfrom5to7.wav", 1, 11025);
+    audio->set_range({500, 0});
+    EXPECT_TRUE(audio->config_decoder());
+    auto fft = std::make_unique<siren::KissFFT>(siren::WindowFunction::Hanning, 1024);
+    siren::Spectrogram spectrogram(std::move(audio), std::move(fft), nullptr, 512);
+
+    const std::string dir = std::filesystem::temp_directory_path().string();
+    const std::string spectrogram_path = dir + "/siren_cache_test.spec";
+    const std::string peaks_path = dir + "/siren_cache_test_peaks.spec";
+    ASSERT_TRUE(spectrogram.write(spectrogram_path, "spectrogram"));
+    EXPECT_EQ(siren::Spectrogram::load(spectrogram_path, "another key"), nullptr);
+
+    auto loaded = siren::Spectrogram::load(spectrogram_path, "spectrogram");
+    ASSERT_NE(loaded, nullptr);
+    EXPECT_EQ(loaded->get_magnitudes(), spectrogram.get_magnitudes());
+    EXPECT_EQ(loaded->get_bin_frequencies(), spectrogram.get_bin_frequencies());
+    EXPECT_EQ(loaded->get_time_offset(), spectrogram.get_time_offset());
+    EXPECT_EQ(loaded->get_hop_size(), 512);
+
+    siren::PeakSpectrogram peaks(std::move(spectrogram));
+    siren::PeakSpectrogram loaded_peaks(std::move(*loaded));
+    ASSERT_TRUE(peaks.write(peaks_path, "peaks"));
+    auto cached_peaks = siren::PeakSpectrogram::load(peaks_path, "peaks");
+    ASSERT_NE(cached_peaks, nullptr);
+    EXPECT_FALSE(cached_peaks->has_magnitudes());
+    EXPECT_EQ(cached_peaks->get_occupied_indices(), peaks.get_occupied_indices());
+
+    siren::Fingerprint fingerprint, loaded_fingerprint, cached_fingerprint;
+    EXPECT_EQ(fingerprint.make_fingerprint(peaks, 455, 350, 0.5), siren::CoreStatus::OK);
+    EXPECT_EQ(loaded_fingerprint.make_fingerprint(loaded_peaks, 455, 350, 0.5), siren::CoreStatus::OK);
+    EXPECT_EQ(cached_fingerprint.make_fingerprint(*cached_peaks, 455, 350, 0.5), siren::CoreStatus::OK);
+    EXPECT_EQ(fingerprint, loaded_fingerprint);
+    EXPECT_EQ(fingerprint, cached_fingerprint);
+
+    std::filesystem::remove(spectrogram_path);
+    std::filesystem::remove(peaks_path);
+}
+
+TEST(Spectrogram, SilenceGate)
+{
+    const unsigned int sampling_rate = 11025;
+    auto decoded = std::make_unique<siren::audio::PCM>("../audio/jazzfrom5to7.wav", 1, sampling_rate);
+    EXPECT_TRUE(decoded->config_decoder());
+
+    // a second of digital silence in the middle of the track
+    std::vector<float> samples = *decoded->get_samples();
+    const size_t silence_start = samples.size() / 2;
+    samples.insert(samples.begin() + silence_start, sampling_rate, 0.0f);
+
+    auto make_spectrogram = [&](float silence_threshold)
+    {
+        auto audio = std::make_unique<siren::audio::PCM>(1, sampling_rate);
+        EXPECT_TRUE(audio->config_samples(samples.data(), samples.size(), 1, sampling_rate));
+        auto fft = std::make_unique<siren::KissFFT>(siren::WindowFunction::Hanning, 1024);
+        return siren::Spectrogram(std::move(audio), std::move(fft), nullptr, 512, nullptr, silence_threshold);
+    };
+    auto full = make_spectrogram(0);
+    auto gated = make_spectrogram(1e-4);
+    ASSERT_LT(gated.get_frame_count(), full.get_frame_count());
+    EXPECT_EQ(gated.cols(), full.cols());
+
+    // the kept frames are untouched and keep their timestamps
+    size_t f_idx = 0;
+    for (size_t g_idx = 0; g_idx < gated.get_frame_count(); g_idx++)
+    {
+        while (full.get_frame_timestamp(f_idx) != gated.get_frame_timestamp(g_idx))
+        {
+            f_idx++;
+        }
+        ASSERT_LT(f_idx, full.get_frame_count());
+        EXPECT_TRUE(std::equal(gated.get_frame(g_idx), gated.get_frame(g_idx) + gated.get_bin_count(), full.get_frame(f_idx)));
+    }
+
+    // only windows entirely inside the silence are gated
+    const size_t silence_start_ms = silence_start * 1000 / sampling_rate;
+    for (size_t g_idx = 0; g_idx < gated.get_frame_count(); g_idx++)
+    {
+        size_t timestamp = gated.get_frame_timestamp(g_idx);
+        EXPECT_FALSE(timestamp > silence_start_ms + 100 && timestamp + 100 < silence_start_ms + 1000);
+    }
+}
+
+TEST(Spectrogram, SilenceGateSplitsLocalMaximum)
+{
+    const unsigned int sampling_rate = 11025;
+    auto decoded = std::make_unique<siren::audio::PCM>("../audio/jazzfrom5to7.wav", 1, sampling_rate);
+    EXPECT_TRUE(decoded->config_decoder());
+
+    std::vector<float> samples = *decoded->get_samples();
+    samples.insert(samples.begin() + samples.size() / 2, sampling_rate, 0.0f);
+
+    auto audio = std::make_unique<siren::audio::PCM>(1, sampling_rate);
+    EXPECT_TRUE(audio->config_samples(samples.data(), samples.size(), 1, sampling_rate));
+    auto fft = std::make_unique<siren::KissFFT>(siren::WindowFunction::Hanning, 1024);
+    siren::Spectrogram gated(std::move(audio), std::move(fft), nullptr, 512, nullptr, 1e-4);
+
+    const auto runs = gated.get_frame_runs();
+    ASSERT_EQ(runs.size(), 2);
+    EXPECT_EQ(runs.front().first, 0);
+    EXPECT_EQ(runs.front().second, runs.back().first);
+    EXPECT_EQ(runs.back().second, gated.get_frame_count());
+
+    const std::string path = std::filesystem::temp_directory_path().string() + "/siren_gate_test.spec";
+    ASSERT_TRUE(gated.write(path, "gated"));
+    auto loaded = siren::Spectrogram::load(path, "gated");
+    ASSERT_NE(loaded, nullptr);
+    EXPECT_EQ(loaded->get_frame_runs(), runs);
+    std::filesystem::remove(path);
+
+    // with every value above the threshold, the peaks are exactly the local maxima within each run
+    const siren::PeakNeighborhood neighborhood{4, 3};
+    const std::vector<float> magnitudes = gated.get_magnitudes();
+    const size_t bins = gated.get_bin_count();
+    std::vector<std::pair<size_t, size_t>> expected;
+    for (auto [first, last] : runs)
+    {
+        for (size_t f = first; f < last; f++)
+        {
+            for (size_t b = 0; b < bins; b++)
+            {
+                const float value = magnitudes[f * bins + b];
+                bool is_maximum = value > 0;
+                for (size_t nf = std::max(f, first + neighborhood.frames) - neighborhood.frames; nf < std::min(last, f + neighborhood.frames + 1); nf++)
+                {
+                    for (size_t nb = std::max(b, neighborhood.bins) - neighborhood.bins; nb < std::min(bins, b + neighborhood.bins + 1); nb++)
+                    {
+                        is_maximum = is_maximum && magnitudes[nf * bins + nb] <= value;
+                    }
+                }
+                if (is_maximum)
+                {
+                    expected.emplace_back(gated.get_bin_frequency(b), gated.get_frame_timestamp(f));
+                }
+            }
+        }
+    }
+
+    siren::PeakSpectrogram peaks(std::move(gated), -1e9, 15, siren::StatsEngine::Select, siren::PeakDetector::LocalMaximum, neighborhood);
+    std::vector<std::pair<size_t, size_t>> found;
+    const auto& view = peaks.get_peak_spec_view();
+    for (int row = 0; row < view.outerSize(); row++)
+    {
+        for (Eigen::SparseMatrix<float, Eigen::RowMajor>::InnerIterator it(view, row); it; ++it)
+        {
+            found.emplace_back(it.row(), it.col());
+        }
+    }
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(found, expected);
+}
+
+TEST(Spectrogram, Filterbank)
+{
+    const size_t window_size = 1024;
+    const unsigned int sampling_rate = 11025;
+
+    for (auto scale : {siren::FrequencyScale::Log, siren::FrequencyScale::Mel})
+    {
+        siren::Filterbank filterbank(scale, 48, window_size, sampling_rate);
+        const auto& centres = filterbank.get_centre_frequencies();
+        ASSERT_EQ(filterbank.get_filter_count(), 48);
+        EXPECT_TRUE(std::is_sorted(centres.begin(), centres.end()));
+        EXPECT_LT(centres.back(), sampling_rate / 2);
+
+        // a flat spectrum stays flat since every filter averages its bins
+        std::vector<float> flat(window_size / 2 + 1, 2.0f), output(48);
+        filterbank.apply(flat.data(), output.data());
+        for (float value : output)
+        {
+            EXPECT_NEAR(value, 2.0f, 1e-5);
+        }
+
+        auto make_spectrogram = [&](const siren::Filterbank* filterbank)
+        {
+            auto audio = std::make_unique<siren::audio::PCM>("../audio/jazzfrom5to7.wav", 1, sampling_rate);
+            EXPECT_TRUE(audio->config_decoder());
+            auto fft = std::make_unique<siren::KissFFT>(siren::WindowFunction::Hanning, window_size);
+            return siren::Spectrogram(std::move(audio), std::move(fft), nullptr, 0, filterbank);
+        };
+        auto linear = make_spectrogram(nullptr);
+        auto filtered = make_spectrogram(&filterbank);
+        ASSERT_EQ(filtered.get_bin_count(), 48);
+        ASSERT_EQ(filtered.get_frame_count(), linear.get_frame_count());
+
+        // the linear frame lacks the nyquist bin, which no filter reaches
+        std::vector<float> frame(linear.get_frame(3), linear.get_frame(3) + linear.get_bin_count());
+        frame.push_back(0.0f);
+        filterbank.apply(frame.data(), output.data());
+        for (size_t f_idx = 0; f_idx < 48; f_idx++)
+        {
+            EXPECT_EQ(filtered.get_frame(3)[f_idx], output[f_idx]);
+            EXPECT_EQ(filtered.get_bin_frequency(f_idx), static_cast<size_t>(centres[f_idx]));
+        }
+        EXPECT_GT(siren::PeakSpectrogram(std::move(filtered)).get_peak_spec_view().nonZeros(), 0);
+    }
+}
+
+TEST(Spectrogram, FilterbankLimitsFilterCount)
+{
+    const size_t window_size = 1024;
+    const unsigned int sampling_rate = 11025;
+
+    for (auto scale : {siren::FrequencyScale::Log, siren::FrequencyScale::Mel})
+    {
+        // far more filters than there are Hz between the first bin and nyquist
+        siren::Filterbank filterbank(scale, 20000, window_size, sampling_rate);
+        ASSERT_GT(filterbank.get_filter_count(), 1);
+        ASSERT_LT(filterbank.get_filter_count(), sampling_rate / 2);
+
+        auto audio = std::make_unique<siren::audio::PCM>("../audio/jazzfrom5to7.wav", 1, sampling_rate);
+        EXPECT_TRUE(audio->config_decoder());
+        auto fft = std::make_unique<siren::KissFFT>(siren::WindowFunction::Hanning, window_size);
+        siren::Spectrogram spectrogram(std::move(audio), std::move(fft), nullptr, 0, &filterbank);
+
+        // every filter keeps a row of its own, so the sparse layout holds every non-zero magnitude once
+        const auto& rows = spectrogram.get_bin_frequencies();
+        ASSERT_EQ(rows.size(), filterbank.get_filter_count());
+        EXPECT_TRUE(std::adjacent_find(rows.begin(), rows.end(), std::greater_equal<>()) == rows.end());
+        const auto& magnitudes = spectrogram.get_magnitudes();
+        EXPECT_EQ(spectrogram.make_sparse_spectrogram().nonZeros(), std::count_if(magnitudes.begin(), magnitudes.end(), [](float value) { return value != 0; }));
+    }
+}
+
 TEST(Fingerprint, Trivial)
 {
     const std::string path = "../audio/jazzfrom5to7.wav";
@@ -50,4 +539,176 @@ TEST(Fingerprint, RangeConstructor)
     siren::Fingerprint f1(data.begin(), data.end());
     siren::Fingerprint f2(data.cbegin(), data.cend());
     EXPECT_EQ(f1, f2);
-}
\ No newline at end of file
+}
+
+TEST(FFT, RealMatchesComplex)
+{
+    const size_t window_size = 1024;
+    siren::KissFFT complex_fft(siren::WindowFunction::Hanning, window_size);
+    siren::KissFFTR real_fft(siren::WindowFunction::Hanning, window_size);
+
+    std::vector<float> window(window_size);
+    for (size_t i = 0; i < window_size; i++)
+    {
+        window[i] = std::sin(0.05f * i) + 0.5f * std::cos(0.31f * i);
+    }
+    complex_fft.process_window(std::vector<float>(window));
+    real_fft.process_window(std::move(window));
+
+    EXPECT_EQ(real_fft.get_fft_size(), window_size / 2 + 1);
+    for (size_t i = 0; i < real_fft.get_fft_size(); i++)
+    {
+        EXPECT_NEAR(real_fft.get_real_by_idx(i), complex_fft.get_real_by_idx(i), 1e-3);
+        EXPECT_NEAR(real_fft.get_imag_by_idx(i), complex_fft.get_imag_by_idx(i), 1e-3);
+    }
+}
+
+TEST(FFT, BatchMatchesWindowed)
+{
+    const size_t window_size = 512;
+    const size_t frame_count = 11;
+    siren::KissFFT complex_fft(siren::WindowFunction::Hanning, window_size);
+    siren::BatchFFT batch_fft(siren::WindowFunction::Hanning, window_size);
+
+    std::vector<float> samples(window_size * frame_count);
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        samples[i] = std::sin(0.05f * i) + 0.5f * std::cos(0.0031f * i * i);
+    }
+    std::vector<const float*> frames;
+    for (size_t k = 0; k < frame_count; k++)
+    {
+        frames.push_back(samples.data() + k * window_size);
+    }
+
+    const size_t bin_count = batch_fft.get_bin_count();
+    std::vector<float> batch_r(frame_count * bin_count), batch_i(frame_count * bin_count);
+    batch_fft.process_batch(frames.data(), frame_count, batch_r.data(), batch_i.data());
+
+    std::vector<float> looped_r(frame_count * window_size), looped_i(frame_count * window_size);
+    complex_fft.process_batch(frames.data(), frame_count, looped_r.data(), looped_i.data());
+
+    for (size_t k = 0; k < frame_count; k++)
+    {
+        complex_fft.process_window(std::vector<float>(frames[k], frames[k] + window_size));
+        for (size_t i = 0; i < bin_count; i++)
+        {
+            EXPECT_EQ(looped_r[k * window_size + i], complex_fft.get_real_by_idx(i));
+            EXPECT_EQ(looped_i[k * window_size + i], complex_fft.get_imag_by_idx(i));
+            EXPECT_NEAR(batch_r[k * bin_count + i], complex_fft.get_real_by_idx(i), 1e-3);
+            EXPECT_NEAR(batch_i[k * bin_count + i], complex_fft.get_imag_by_idx(i), 1e-3);
+        }
+    }
+}
+
+TEST(FFT, MagnitudesMatchFreqBin)
+{
+    const size_t window_size = 1024;
+    const unsigned int sampling_rate = 11025;
+    siren::KissFFTR fft(siren::WindowFunction::Hanning, window_size);
+
+    std::vector<float> window(window_size);
+    for (size_t i = 0; i < window_size; i++)
+    {
+        window[i] = std::sin(0.05f * i) + 0.5f * std::cos(0.31f * i);
+    }
+    const float* frame = window.data();
+    std::vector<float> magnitude(fft.get_bin_count());
+    fft.process_magnitudes(&frame, 1, magnitude.data());
+    fft.process_window(std::move(window));
+
+    for (size_t i = 0; i < fft.get_bin_count(); i++)
+    {
+        siren::FreqBin freq_bin(i, window_size, sampling_rate, fft.get_real_by_idx(i), fft.get_imag_by_idx(i));
+        EXPECT_EQ(magnitude[i], freq_bin.get_magnitude());
+    }
+}
+
+TEST(FFT, SimdKernelsMatchScalar)
+{
+    const size_t size = 37;
+    std::vector<float> re(size), im(size), window(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        re[i] = std::sin(0.7f * i) * 40.0f;
+        im[i] = std::cos(1.3f * i) * 15.0f;
+        window[i] = 0.5f * (1 - std::cos(0.1f * i));
+    }
+    im[3] = re[3] = 0.0f;
+
+    std::vector<float> windowed(size), complex(size * 2), power(size), magnitude(size), db(size), maximum(size);
+    siren::simd::maximum(re.data(), im.data(), maximum.data(), size);
+    std::vector<int32_t> fixed_re(re.begin(), re.end()), fixed_im(im.begin(), im.end()), fixed_maximum(size);
+    siren::simd::maximum(fixed_re.data(), fixed_im.data(), fixed_maximum.data(), size);
+    siren::simd::apply_window(re.data(), window.data(), windowed.data(), size);
+    siren::simd::apply_window_complex(re.data(), window.data(), complex.data(), size);
+    siren::simd::power(re.data(), im.data(), power.data(), size);
+    siren::simd::magnitude(re.data(), im.data(), magnitude.data(), size);
+    siren::simd::magnitude_db(re.data(), im.data(), db.data(), size);
+
+    for (size_t i = 0; i < size; i++)
+    {
+        EXPECT_EQ(maximum[i], std::max(re[i], im[i]));
+        EXPECT_EQ(fixed_maximum[i], std::max(fixed_re[i], fixed_im[i]));
+        EXPECT_EQ(windowed[i], re[i] * window[i]);
+        EXPECT_EQ(complex[i * 2], re[i] * window[i]);
+        EXPECT_EQ(complex[i * 2 + 1], 0.0f);
+        EXPECT_EQ(power[i], static_cast<float>(std::pow(re[i], 2) + std::pow(im[i], 2)));
+        EXPECT_EQ(magnitude[i], siren::FreqBin(i, size, 11025, re[i], im[i]).get_magnitude());
+        if (magnitude[i] > 0)
+        {
+            EXPECT_NEAR(db[i], 20 * std::log10(magnitude[i]), 1e-3);
+        }
+    }
+    EXPECT_EQ(db[3], -120.0f);
+}
+
+TEST(FFT, PlanCacheSharesTables)
+{
+    siren::FFTPlanCache& cache = siren::FFTPlanCache::instance();
+    auto hanning = cache.get_window(siren::WindowFunction::Hanning, 1024);
+    EXPECT_EQ(hanning, cache.get_window(siren::WindowFunction::Hanning, 1024));
+    EXPECT_NE(hanning, cache.get_window(siren::WindowFunction::Hamming, 1024));
+    EXPECT_NE(hanning, cache.get_window(siren::WindowFunction::Hanning, 512));
+    EXPECT_EQ(hanning->size(), 1024);
+
+    auto make_plan = [](size_t size)
+    {
+        return std::make_unique<siren::KissPlan>(size);
+    };
+    EXPECT_EQ(cache.get_plan<siren::KissPlan>(1024, make_plan), cache.get_plan<siren::KissPlan>(1024, make_plan));
+}
+
+TEST(FFT, FixedPointMatchesFloat)
+{
+    const size_t window_size = 1024;
+    siren::KissFFTR float_fft(siren::WindowFunction::Hanning, window_size);
+    siren::FixedPointFFT fixed_fft(siren::WindowFunction::Hanning, window_size);
+
+    std::vector<float> window(window_size);
+    for (size_t i = 0; i < window_size; i++)
+    {
+        window[i] = 0.6f * std::sin(0.05f * i) + 0.3f * std::cos(0.31f * i);
+    }
+    const float* frame = window.data();
+    std::vector<float> expected(window_size / 2 + 1), actual(window_size / 2 + 1);
+    std::vector<int32_t> fixed(window_size / 2 + 1);
+    float_fft.process_magnitudes(&frame, 1, expected.data());
+    fixed_fft.process_magnitudes(&frame, 1, actual.data());
+    fixed_fft.process_magnitudes_fixed(&frame, 1, fixed.data());
+
+    EXPECT_TRUE(fixed_fft.is_fixed_point());
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        // quantizing samples and window to Q15 keeps the error within a few thousandths on a 1024 window
+        EXPECT_NEAR(actual[i], expected[i], 5e-3f);
+        EXPECT_EQ(actual[i], static_cast<float>(fixed[i]) / siren::FixedPointFFT::s_one);
+    }
+
+    // the spectrogram keeps the Q15 integers and never stores float magnitudes
+    auto audio = std::make_unique<siren::audio::PCM>("../audio/jazzfrom5to7.wav", 1, 11025);
+    EXPECT_TRUE(audio->config_decoder());
+    siren::Spectrogram spectrogram(std::move(audio), std::make_unique<siren::FixedPointFFT>(siren::WindowFunction::Hanning, window_size));
+    EXPECT_TRUE(spectrogram.get_magnitudes().empty());
+    EXPECT_EQ(spectrogram.get_fixed_magnitudes().size(), spectrogram.get_frame_count() * spectrogram.get_bin_count());
+}
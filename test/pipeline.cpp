@@ -0,0 +1,28 @@
+#include <gtest/gtest.h>
+#include "common.h"
+#include "../src/pipeline/batch_executor.h"
+
+TEST(Pipeline, MatchesSequentialCore)
+{
+    auto core = test_common::CommonCore::GetCore();
+    std::vector<std::string> tracks(6, "../audio/jazzfrom5to7.wav");
+    tracks[3] = "../audio/none.wav";
+
+    siren::pipeline::PipelineParameters params;
+    params.queue_capacity = 1;
+    siren::pipeline::BatchExecutor executor(*core, params);
+    auto results = executor.run(tracks);
+
+    auto expected = core->make_fingerprint("../audio/jazzfrom5to7.wav");
+    ASSERT_EQ(results.size(), tracks.size());
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        if (i == 3)
+        {
+            EXPECT_EQ(results[i].code, siren::CoreStatus::TargetFileDoesNotExist);
+            continue;
+        }
+        EXPECT_EQ(results[i].code, siren::CoreStatus::OK);
+        EXPECT_EQ(results[i].fingerprint, expected.fingerprint);
+    }
+}
@@ -0,0 +1,49 @@
+#include <cmath>
+#include <gtest/gtest.h>
+#include "../src/decoder/resampler.h"
+
+std::vector<float> make_sine(float freq, unsigned int sampling_rate, size_t count)
+{
+    std::vector<float> sine(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        sine[i] = std::sin(2 * M_PI * freq * i / sampling_rate);
+    }
+    return sine;
+}
+
+TEST(Resampler, IntegerRatio)
+{
+    auto input = make_sine(440, 44100, 44100);
+    siren::audio::Resampler resampler(44100, 11025);
+
+    std::vector<float> output;
+    resampler.process(input.data(), input.size(), output);
+    resampler.flush(output);
+    EXPECT_EQ(output.size(), 11025);
+
+    auto expected = make_sine(440, 11025, 11025);
+    for (size_t i = 100; i < output.size() - 100; i++)
+    {
+        EXPECT_NEAR(output[i], expected[i], 1e-2);
+    }
+}
+
+TEST(Resampler, ChunkedMatchesOneShot)
+{
+    auto input = make_sine(1000, 48000, 48000);
+    siren::audio::Resampler one_shot(48000, 11025, siren::audio::ResamplerQuality::Best);
+    siren::audio::Resampler chunked(48000, 11025, siren::audio::ResamplerQuality::Best);
+
+    std::vector<float> expected, actual;
+    one_shot.process(input.data(), input.size(), expected);
+    one_shot.flush(expected);
+    for (size_t i = 0; i < input.size(); i += 777)
+    {
+        chunked.process(input.data() + i, std::min<size_t>(777, input.size() - i), actual);
+    }
+    chunked.flush(actual);
+
+    EXPECT_EQ(expected.size(), one_shot.get_output_count(input.size()));
+    EXPECT_EQ(expected, actual);
+}